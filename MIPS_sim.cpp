@@ -1,53 +1,166 @@
+#include <algorithm>
+#include <atomic>
 #include <bitset>
+#include <chrono>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "block_cache.h"
+#include "branch.h"
 #include "cache.h"
+#include "decode.h"
+#include "encode.h"
+#include "image_cache.h"
+#include "jit.h"
+#include "lexer.h"
+#include "lookup.h"
+#include "memory.h"
+#include "ooo.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "stats.h"
+#include "trace.h"
+
+// Execution engine used by executeInstructions
+enum class Engine {
+    Interpreter,  // Decoded-stream interpreter with cache model and full tracing
+    Threaded,     // Direct-threaded dispatch, functional only
+    Block,        // Chained basic-block translation cache, functional only
+    Jit,          // x86-64 translation of hot blocks, functional only
+    Differential, // Jit checked against the functional interpreter on a second processor
+};
+
+// One .text instruction as laid out by pass 1
+struct SourceInstruction {
+    std::string_view text;  // Source text, a view into MIPSprocessor::source
+    Mnemonic mnemonic;      // Mnemonic::Count when the mnemonic is unknown
+    uint32_t address;       // Address of the first encoded word
+    uint32_t line;          // 1-based source line
+    uint32_t size;          // Encoded size in bytes (4, or 8 for lui expansions)
+};
+
+// Error found while encoding; reported with its source line once pass 2 has finished
+class AssemblyError : public std::runtime_error {
+   public:
+    using std::runtime_error::runtime_error;
+};
 
 class MIPSprocessor  // Class for the processor
 {
    public:
     std::unordered_map<std::string, uint32_t> symbolTable;  // To store variables from .data section
-    std::vector<std::string> instructions;                  // Store instructions from .text section
+    std::string source;                                     // Source text, kept alive for the views below
+    std::vector<SourceInstruction> instructions;            // Store instructions from .text section
+    std::vector<uint32_t> sourceLines;                      // Source line of each text word, indexed by (PC - 0x100) >> 2
+    uint32_t textEnd;                                       // First address past the encoded text
     uint32_t dataMemoryStart;                               // Start address for .data section
     uint32_t currentDataAddress;                            // Current address for data section
     uint32_t PC;                                            // Start address for .text section
     uint32_t instructionSize;                               // Address of the last instruction
-    uint8_t memoryAdd[0x1000];                              // Memory address
-    LFUCache instructionCache;                              // Instruction cache
-    LFUCache dataCache;                                     // Data cache
+    PagedMemory memory;                                     // Guest memory (full 32-bit space)
+    CodePageMap codePages;                                  // Memory that instructions were fetched from
+    CacheModel instructionCache;                            // Instruction cache model
+    CacheModel dataCache;                                   // Data cache model
+    MemoryHierarchy hierarchy;                              // L2 and L3 behind both caches
+    PipelineModel pipeline;                                 // Five-stage pipeline timing of interpreter runs
+    bool pipelined;                                         // Feed the pipeline model
+    OutOfOrderModel outOfOrderCore;                         // Out-of-order core timing of interpreter runs
+    bool outOfOrder;                                        // Feed the out-of-order model
+    BranchPredictionUnit branchUnit;                        // Predictors consulted on every control transfer
+    bool predicting;                                        // Feed the branch predictors
+    Profiler profiler;                                      // Per-PC counts and call paths of interpreter runs
+    bool profiling;                                         // Feed the profiler
+    WorkloadStats workloadStats;                            // Instruction mix and access patterns of interpreter runs
+    bool collectingStats;                                   // Feed workloadStats
     uint32_t registers[32], floatRegisters[32], HI, LO;     // registers + HI and LO registers
     std::unordered_map<std::string, uint32_t> funcMap;      // Map for function name and address
+    std::unordered_map<std::string, uint32_t> labelStarts;  // Label -> address of its first encoded word
     bool running;                                           // Variable to control the state of the processor
+    TraceLevel traceLevel;                                  // Runtime trace verbosity
+    std::vector<DecodedInstruction> decodedInstructions;    // Decoded .text words indexed by (PC - 0x100) >> 2
+    DecodedInstruction scratchInstruction;                  // Decoded word fetched from outside the .text words
+    Engine engine;                                          // Engine selected for executeInstructions
+    BlockCache blockCache;                                  // Translated basic blocks for Engine::Block and Engine::Jit
+    JitCompiler jit;                                        // Host code for hot blocks
+    bool syscallOutput;                                     // Print syscall results (off for a differential reference)
+    uint64_t instructionCount;                              // Instructions executed by the last run
+    uint64_t fetchStallCycles;                              // Cycles instruction fetches spent beyond one cycle
+    uint64_t dataStallCycles;                               // Cycles loads and stores spent beyond one cycle
+
+    static constexpr size_t kAssemblyChunk = 4096;  // Instructions per pass-2 work item
 
     // Control signals
     std::bitset<1> RegDst, Branch, ReadMem, MemtoReg, WriteMem, ALUSrc, WriteReg, ALUOp0, ALUOp1, Jump;
 
+    // Reads, lays out and assembles a source file. With useImageCache the assembled program is
+    // loaded from filename + ".img" when that image was built from identical source, and the
+    // image is rewritten otherwise. The assembly listing always assembles from source.
+    void loadProgram(const std::string& filename, bool useImageCache) {
+        readSource(filename);
+        if (!useImageCache) {
+            layoutSource();
+            assembleInstructions();
+            return;
+        }
+
+        std::string imagePath = filename + ".img";
+        uint64_t sourceHash = hashSource(source);
+        if (!listingEnabled() && loadImage(imagePath, sourceHash)) return;
+
+        layoutSource();
+        assembleInstructions();
+        if (!saveImage(imagePath, sourceHash)) {
+            std::cerr << "Warning: Cannot write program image: " << imagePath << std::endl;
+        }
+    }
+
     // Function to read file and process .data and .text sections
     void readFile(const std::string& filename) {
-        PC = 0x0100;  // Reset the program counter
+        readSource(filename);
+        layoutSource();
+    }
 
-        std::ifstream file(filename);
-        std::string line;
+    // Reads the whole file once; instructions are views into this buffer
+    void readSource(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: Cannot open source file: " << filename << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        file.seekg(0, std::ios::end);
+        source.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(&source[0], static_cast<std::streamsize>(source.size()));
+        file.close();
+    }
+
+    // Pass 1: fills the .data section and lays out .text (addresses, labels, sizes)
+    void layoutSource() {
+        // Labels are placed as if every lw, sw and la took two words, as the assembler always has;
+        // address tracks where the encoded words really go (lw/sw with offset(base) take one)
+        PC = 0x0100;
+        uint32_t address = 0x0100;
+
+        Lexer lexer(source);
+        std::string_view line;
         bool inDataSection = false;
         bool inTextSection = false;
 
-        while (std::getline(file, line)) {
-            // Trim leading and trailing whitespace
-            line.erase(0, line.find_first_not_of(" \t"));
-            line.erase(line.find_last_not_of(" \t") + 1);
-
+        while (lexer.nextLine(line)) {
             // Skip empty lines and comments
             if (line.empty() || line[0] == '#') continue;
 
-            std::istringstream iss(line);
-            std::string token;
-            iss >> token;
+            LineTokenizer tokens(line);
+            std::string_view token;
+            if (!tokens.next(token)) continue;  // Nothing but separators
 
             if (token == ".data") {
                 inDataSection = true;
@@ -60,1148 +173,1188 @@ class MIPSprocessor  // Class for the processor
             }
 
             if (inTextSection) {
-                if (!token.empty()) {
-                    // If it's a label (ending with ':')
-                    if (token.back() == ':') {
-                        std::string label = token.substr(0, token.size() - 1);
-
-                        // Store the address of the label
-                        funcMap[label] = PC + 4;
-                    } else {
-                        instructions.push_back(line);  // Add instruction to the list
-                        if (token == "lw" || token == "sw" || token == "la") {
-                            PC += 8;  // Increment the program counter by 8 for lw, sw, and la instructions
-                        } else {
-                            PC += 4;  // Increment the program counter by 4 for other instructions
-                        }
-                    }
+                // If it's a label (ending with ':'), an instruction may follow on the same line
+                if (token.back() == ':') {
+                    std::string label(token.substr(0, token.size() - 1));
+
+                    // Store the address of the label
+                    funcMap[label] = PC + 4;
+                    labelStarts[label] = address;
+
+                    line = tokens.rest();
+                    if (line.empty() || line[0] == '#') continue;
+                    tokens = LineTokenizer(line);
+                    if (!tokens.next(token)) continue;
+                }
+
+                SourceInstruction instruction{line, Mnemonic::Count, address, lexer.lineNumber(), 4};
+                lookupMnemonic(token, instruction.mnemonic);
+                uint32_t layoutSize = 4;
+                if (instruction.mnemonic == Mnemonic::Lw || instruction.mnemonic == Mnemonic::Sw) {
+                    std::string_view reg, operand;
+                    tokens.next(reg);
+                    tokens.next(operand);
+                    layoutSize = 8;
+                    if (!isBaseOffset(operand)) instruction.size = 8;  // lui $at + lw/sw
+                } else if (instruction.mnemonic == Mnemonic::La) {
+                    layoutSize = 8;
+                    instruction.size = 8;  // lui + addi
                 }
+
+                instructions.push_back(instruction);  // Add instruction to the list
+                PC += layoutSize;
+                address += instruction.size;
             } else if (inDataSection) {
                 processDataSection(line);  // Process the data section
             }
         }
 
-        file.close();
+        textEnd = address;
     }
 
     // Function to process .data section
-    void processDataSection(const std::string& line) {
-        std::istringstream iss(line);
-        std::string varName, directive, value;
+    void processDataSection(std::string_view line) {
+        LineTokenizer tokens(line);
+        std::string_view varName, directive, value;
 
-        iss >> varName;      // variable name (e.g., num1:)
-        varName.pop_back();  // remove the colon (:)
-        iss >> directive;    // directive (e.g., .word)
-        iss >> value;        // value (e.g., 5)
+        tokens.next(varName);                             // variable name (e.g., num1:)
+        varName = varName.substr(0, varName.size() - 1);  // remove the colon (:)
+        tokens.next(directive);                           // directive (e.g., .word)
 
         if (directive == ".word") {
             // num1: .word 5 or numArray: .word 1, 2, 3, 4
-            std::vector<int> intValues;
-            std::string temp;
-            std::istringstream valueStream(value);
-
-            while (std::getline(valueStream, temp, ',')) {
-                intValues.push_back(std::stoi(temp));
-            }
+            symbolTable[std::string(varName)] = currentDataAddress;  // Store starting address
 
-            symbolTable[varName] = currentDataAddress;  // Store starting address
-
-            for (int intValue : intValues) {
-                std::memcpy(&memoryAdd[currentDataAddress], &intValue, sizeof(int));  // Copy integer as bytes
-                currentDataAddress += 4;                                              // Increment by 4 bytes (word-aligned)
+            while (tokens.next(value)) {
+                int intValue;
+                if (!parseInteger(value, intValue)) {
+                    std::cerr << "Error: Invalid .word value: " << value << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                memory.writeWord(currentDataAddress, static_cast<uint32_t>(intValue));  // Store integer as bytes
+                currentDataAddress += 4;                                                // Increment by 4 bytes (word-aligned)
             }
         } else if (directive == ".asciiz") {
-            std::string strValue = value;
-            symbolTable[varName] = currentDataAddress;
-            for (char c : strValue) {
-                memoryAdd[currentDataAddress++] = static_cast<uint8_t>(c);  // Store each character
+            tokens.next(value);
+            symbolTable[std::string(varName)] = currentDataAddress;
+            for (char c : value) {
+                memory.writeByte(currentDataAddress++, static_cast<uint8_t>(c));  // Store each character
             }
-            memoryAdd[currentDataAddress++] = 0;  // Null-terminate the string
+            memory.writeByte(currentDataAddress++, 0);  // Null-terminate the string
         } else if (directive == ".float") {
-            float floatValue = std::stof(value);
-            std::memcpy(&memoryAdd[currentDataAddress], &floatValue, sizeof(float));  // Copy float as bytes
-            symbolTable[varName] = currentDataAddress;                                // Store starting address
+            tokens.next(value);
+            float floatValue = std::stof(std::string(value));
+            uint32_t floatBits;
+            std::memcpy(&floatBits, &floatValue, sizeof(float));
+            memory.writeWord(currentDataAddress, floatBits);  // Store float as bytes
+            symbolTable[std::string(varName)] = currentDataAddress;                  // Store starting address
             currentDataAddress += 4;                                                  // Increment by 4 bytes (word-aligned)
         }
     }
 
-    // Function to convert each instruction into 32-bit machine code
+    // Pass 2: encodes every instruction into a text image, in parallel chunks for large
+    // programs. Errors are collected per chunk and the first one in source order is reported.
     void assembleInstructions() {
-        PC = 0x0100;  // Reset the program counter
-
-        for (const auto& instr : instructions) {
-            std::cout << "Assembly: " << instr << std::endl;
-            convertToMachineCode(instr);
+        const size_t count = instructions.size();
+        std::vector<uint32_t> textImage((textEnd - 0x0100) / 4);
+
+        struct ChunkError {
+            size_t index;  // Instruction that failed, count when the chunk encoded cleanly
+            std::string message;
+        };
+        const size_t chunks = (count + kAssemblyChunk - 1) / kAssemblyChunk;
+        std::vector<ChunkError> errors(chunks, ChunkError{count, ""});
+        std::atomic<size_t> nextChunk{0};
+
+        auto encodeChunks = [&]() {
+            for (size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+                size_t end = std::min(count, (chunk + 1) * kAssemblyChunk);
+                for (size_t i = chunk * kAssemblyChunk; i < end; i++) {
+                    try {
+                        encodeInstruction(instructions[i], &textImage[(instructions[i].address - 0x0100) / 4]);
+                    } catch (const AssemblyError& error) {
+                        errors[chunk] = ChunkError{i, error.what()};
+                        break;
+                    }
+                }
+            }
+        };
+
+        size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), chunks);
+        std::vector<std::thread> pool;
+        for (size_t i = 1; i < workers; i++) pool.emplace_back(encodeChunks);
+        encodeChunks();
+        for (std::thread& thread : pool) thread.join();
+
+        const ChunkError* failure = nullptr;
+        for (const ChunkError& error : errors) {
+            if (error.index < count) {
+                failure = &error;
+                break;
+            }
         }
 
-        instructionSize = PC - 4;  // Store the address of the last instruction
-    }
-
-    // Function to convert each instruction line to 32-bit machine code
-    void convertToMachineCode(const std::string& instruction) {
-        std::istringstream iss(instruction);
-        std::string opcode, reg1, reg2, reg3;
-
-        iss >> opcode;  // Get the operation (e.g., lw, add, etc.)
-
-        if (opcode == "lw") {
-            iss >> reg1 >> reg2;  // lw $t0, num1
-            reg1.pop_back();      // Remove comma
-            lwToMachineCode(reg1, reg2);
-        } else if (opcode == "sw") {
-            iss >> reg1 >> reg2;  // sw $t0, num1
-            reg1.pop_back();      // Remove comma
-            swToMachineCode(reg1, reg2);
-        } else if (opcode == "add") {
-            iss >> reg1 >> reg2 >> reg3;  // add $t2, $t0, $t1
-            reg1.pop_back();              // Remove comma
-            reg2.pop_back();              // Remove comma
-            addToMachineCode(reg1, reg2, reg3);
-        } else if (opcode == "sub") {
-            iss >> reg1 >> reg2 >> reg3;  // sub $t2, $t0, $t1
-            reg1.pop_back();              // Remove comma
-            reg2.pop_back();              // Remove comma
-            subToMachineCode(reg1, reg2, reg3);
-        } else if (opcode == "mult") {
-            iss >> reg1 >> reg2;  // mult $t2, $t0
-            reg1.pop_back();      // Remove comma
-            multToMachineCode(reg1, reg2);
-        } else if (opcode == "div") {
-            iss >> reg1 >> reg2;  // div $t2, $t0
-            reg1.pop_back();      // Remove comma
-            divToMachineCode(reg1, reg2);
-        } else if (opcode == "mflo") {
-            iss >> reg1;  // mflo $t0
-            mfloToMachineCode(reg1);
-        } else if (opcode == "mfhi") {
-            iss >> reg1;  // mfhi $t0
-            mfhiToMachineCode(reg1);
-        } else if (opcode == "addi") {
-            iss >> reg1 >> reg2 >> reg3;  // addi $t2, $t0, 5
-            reg1.pop_back();              // Remove comma
-            reg2.pop_back();              // Remove comma
-            addiToMachineCode(reg1, reg2, reg3);
-        } else if (opcode == "and") {
-            iss >> reg1 >> reg2 >> reg3;  // and $t2, $t0, $t1
-            reg1.pop_back();              // Remove comma
-            reg2.pop_back();              // Remove comma
-            andToMachineCode(reg1, reg2, reg3);
-        } else if (opcode == "or") {
-            iss >> reg1 >> reg2 >> reg3;  // or $t2, $t0, $t1
-            reg1.pop_back();              // Remove comma
-            reg2.pop_back();              // Remove comma
-            orToMachineCode(reg1, reg2, reg3);
-        } else if (opcode == "li") {
-            iss >> reg1 >> reg2;  // li $v0, 1
-            liToMachineCode(reg1, reg2);
-        } else if (opcode == "move") {
-            iss >> reg1 >> reg2;  // move $a0, $t2
-            moveToMachineCode(reg1, reg2);
-        } else if (opcode == "syscall") {
-            syscallToMachineCode();
-        } else if (opcode == "lwc1") {
-            iss >> reg1 >> reg2;  // lwc1 $f0, num1
-            reg1.pop_back();      // Remove comma
-            lwc1ToMachineCode(reg1, reg2);
-        } else if (opcode == "swc1") {
-            iss >> reg1 >> reg2;  // swc1 $f0, num1
-            reg1.pop_back();      // Remove comma
-            swc1ToMachineCode(reg1, reg2);
-        } else if (opcode == "add.s") {
-            iss >> reg1 >> reg2 >> reg3;  // add.s $f0, $f1, $f2
-            reg1.pop_back();              // Remove comma
-            reg2.pop_back();              // Remove comma
-            addSToMachineCode(reg1, reg2, reg3);
-        } else if (opcode == "j") {
-            iss >> reg1;  // j label
-            jToMachineCode(reg1);
-        } else if (opcode == "jr") {
-            iss >> reg1;  // jr $ra
-            jrToMachineCode(reg1);
-        } else if (opcode == "jal") {
-            iss >> reg1;  // jal label
-            jalToMachineCode(reg1);
-        } else if (opcode == "beq") {
-            iss >> reg1 >> reg2 >> reg3;  // beq $t0, $t1, label
-            reg1.pop_back();              // Remove comma
-            reg2.pop_back();              // Remove comma
-            beqToMachineCode(reg1, reg2, reg3);
-        } else if (opcode == "la") {
-            iss >> reg1 >> reg2;  // la $t0, num1
-            reg1.pop_back();      // Remove comma
-            laToMachineCode(reg1, reg2);
-        } else if (opcode == "slt") {
-            iss >> reg1 >> reg2 >> reg3;  // slt $t0, $t1, $t2
-            reg1.pop_back();              // Remove comma
-            reg2.pop_back();              // Remove comma
-            sltToMachineCode(reg1, reg2, reg3);
-        } else {
-            std::cerr << "Error: Invalid instruction: " << opcode << std::endl;
-            exit(EXIT_FAILURE);
+        // Listing and memory image, in source order up to the first error
+        size_t last = failure != nullptr ? failure->index : count;
+        for (size_t i = 0; i < last; i++) {
+            const SourceInstruction& instruction = instructions[i];
+            const uint32_t* words = &textImage[(instruction.address - 0x0100) / 4];
+            listInstruction(instruction, words);
+            for (uint32_t offset = 0; offset < instruction.size; offset += 4) {
+                storeInstructionWord(instruction.address + offset, words[offset / 4]);
+            }
         }
-    }
-
-    // converts register name to number (e.g., $t0 -> 8)
-    int regToNumber(const std::string& reg) {
-        if (reg == "$zero") return 0;
-        if (reg == "$at") return 1;
-        if (reg == "$v0") return 2;
-        if (reg == "$v1") return 3;
-        if (reg == "$a0") return 4;
-        if (reg == "$a1") return 5;
-        if (reg == "$a2") return 6;
-        if (reg == "$a3") return 7;
-        if (reg == "$t0") return 8;
-        if (reg == "$t1") return 9;
-        if (reg == "$t2") return 10;
-        if (reg == "$t3") return 11;
-        if (reg == "$t4") return 12;
-        if (reg == "$t5") return 13;
-        if (reg == "$t6") return 14;
-        if (reg == "$t7") return 15;
-        if (reg == "$s0") return 16;
-        if (reg == "$s1") return 17;
-        if (reg == "$s2") return 18;
-        if (reg == "$s3") return 19;
-        if (reg == "$s4") return 20;
-        if (reg == "$s5") return 21;
-        if (reg == "$s6") return 22;
-        if (reg == "$s7") return 23;
-        if (reg == "$t8") return 24;
-        if (reg == "$t9") return 25;
-        if (reg == "$k0") return 26;
-        if (reg == "$k1") return 27;
-        if (reg == "$gp") return 28;
-        if (reg == "$sp") return 29;
-        if (reg == "$fp") return 30;
-        if (reg == "$ra")
-            return 31;
-        else {
+        if (failure != nullptr) {
+            const SourceInstruction& instruction = instructions[failure->index];
+            if (listingEnabled()) std::cout << "Assembly: " << instruction.text << std::endl;
+            std::cerr << "Error: " << failure->message << " (line " << instruction.line << ")" << std::endl;
             exit(EXIT_FAILURE);
         }
-    }
-
-    // Converts number to register name (e.g., 8 -> $t0)
-    std::string numberToReg(int reg) {
-        switch (reg) {
-            case 0:
-                return "$zero";
-            case 1:
-                return "$at";
-            case 2:
-                return "$v0";
-            case 3:
-                return "$v1";
-            case 4:
-                return "$a0";
-            case 5:
-                return "$a1";
-            case 6:
-                return "$a2";
-            case 7:
-                return "$a3";
-            case 8:
-                return "$t0";
-            case 9:
-                return "$t1";
-            case 10:
-                return "$t2";
-            case 11:
-                return "$t3";
-            case 12:
-                return "$t4";
-            case 13:
-                return "$t5";
-            case 14:
-                return "$t6";
-            case 15:
-                return "$t7";
-            case 16:
-                return "$s0";
-            case 17:
-                return "$s1";
-            case 18:
-                return "$s2";
-            case 19:
-                return "$s3";
-            case 20:
-                return "$s4";
-            case 21:
-                return "$s5";
-            case 22:
-                return "$s6";
-            case 23:
-                return "$s7";
-            case 24:
-                return "$t8";
-            case 25:
-                return "$t9";
-            case 26:
-                return "$k0";
-            case 27:
-                return "$k1";
-            case 28:
-                return "$gp";
-            case 29:
-                return "$sp";
-            case 30:
-                return "$fp";
-            case 31:
-                return "$ra";
-            default:
-                return "";
-        }
-    }
 
-    int floatRegisterToBinary(const std::string& reg) {
-        if (reg[0] == 'f' && reg.size() > 1) {
-            int regNum = std::stoi(reg.substr(1));
-            if (regNum >= 0 && regNum <= 31) {
-                return regNum;
+        // Source line of every text word
+        sourceLines.assign(textImage.size(), 0);
+        for (const SourceInstruction& instruction : instructions) {
+            for (uint32_t offset = 0; offset < instruction.size; offset += 4) {
+                sourceLines[(instruction.address + offset - 0x0100) / 4] = instruction.line;
             }
         }
-        return -1;
-    }
 
-    // Convert instructions to 32-bit machine code
-    void addToMachineCode(const std::string& reg1, const std::string& reg2, const std::string& reg3) {
-        int rd = regToNumber(reg1);
-        int rs = regToNumber(reg2);
-        int rt = regToNumber(reg3);
-
-        std::bitset<6> opcode(0);  // R-type opcode is 0
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(rt);
-        std::bitset<5> rdBin(rd);
-        std::bitset<5> shamt(0);         // Shift amount is 0 for add
-        std::bitset<6> funct(0b100000);  // Function code for add
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
-    }
+        PC = textEnd;
+        instructionSize = textEnd - 4;  // Store the address of the last instruction
 
-    void addiToMachineCode(const std::string& reg1, const std::string& reg2, const std::string& imm) {
-        int rt = regToNumber(reg1);
-        int rs = regToNumber(reg2);
-        int immediate = std::stoi(imm);
-
-        std::bitset<6> opcode(0b001000);  // Opcode for addi
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(rt);
-        std::bitset<16> immBin(immediate);
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + immBin.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+        decodeInstructions();
     }
 
-    void lwToMachineCode(const std::string& reg1, const std::string& address) {
-        int rt = regToNumber(reg1);  // Destination register
-        int base, offset;
-        std::string luiMachineCode;  // Initialize for storing lui machine code
-
-        std::size_t openParen = address.find('(');
-        std::size_t closeParen = address.find(')');
-
-        if (openParen != std::string::npos && closeParen != std::string::npos) {
-            // Extract offset and base register for format "offset(base)"
-            try {
-                offset = std::stoi(address.substr(0, openParen));  // Get the offset part
-            } catch (const std::invalid_argument&) {
-                std::cerr << "Error: Invalid offset value in address: " << address << std::endl;
-                exit(EXIT_FAILURE);
-            }
-
-            std::string baseReg = address.substr(openParen + 1, closeParen - openParen - 1);
-            base = regToNumber(baseReg);
-        } else {
-            // Otherwise, treat it as a variable name
-            if (symbolTable.find(address) == symbolTable.end()) {
-                std::cerr << "Error: Unknown variable '" << address << "'." << std::endl;
-                exit(EXIT_FAILURE);
-            }
+    // Source line of the instruction at address, 0 outside the assembled text
+    uint32_t sourceLineAt(uint32_t address) const {
+        uint32_t index = (address - 0x0100) >> 2;
+        return index < sourceLines.size() ? sourceLines[index] : 0;
+    }
 
-            base = regToNumber("$at");             // Base register is $at ($1)
-            int immediate = symbolTable[address];  // Full 32-bit address
+    // Saves the assembled program: .data bytes, then .text bytes, symbols, labels and line map
+    bool saveImage(const std::string& path, uint64_t sourceHash) const {
+        std::vector<uint8_t> data(currentDataAddress - dataMemoryStart), text(textEnd - 0x0100);
+        memory.readBytes(dataMemoryStart, data.data(), data.size());
+        memory.readBytes(0x0100, text.data(), text.size());
+        std::vector<ImageSegment> segments = {
+            {dataMemoryStart, data.data(), static_cast<uint32_t>(data.size())},
+            {0x0100, text.data(), static_cast<uint32_t>(text.size())},
+        };
+        return writeImage(path, sourceHash, textEnd, currentDataAddress, segments, sourceLines, symbolTable, funcMap,
+                          labelStarts);
+    }
 
-            int upperImmediate = (immediate >> 16) & 0xFFFF;  // Upper 16 bits
-            int lowerImmediate = immediate & 0xFFFF;          // Lower 16 bits
+    // Restores an assembled program saved by saveImage; false if the image is missing or stale
+    bool loadImage(const std::string& path, uint64_t sourceHash) {
+        MappedImage mapped;
+        if (!mapped.open(path, sourceHash)) return false;
+        const ImageContents& image = mapped.contents();
+        if (image.textEnd < 0x0100 || image.lineCount != (image.textEnd - 0x0100) / 4) return false;
 
-            // Create the lui instruction
-            std::bitset<6> luiOpcode(0b001111);        // Opcode for 'lui'
-            std::bitset<5> atBin(regToNumber("$at"));  // $at register
-            std::bitset<16> upperImm(upperImmediate);
+        for (const ImageSegment& segment : image.segments) memory.writeBytes(segment.address, segment.bytes, segment.size);
+        symbolTable.clear();
+        for (const auto& symbol : image.symbols) symbolTable[std::string(symbol.first)] = symbol.second;
+        funcMap.clear();
+        for (const auto& label : image.labels) funcMap[std::string(label.first)] = label.second;
+        labelStarts.clear();
+        for (const auto& label : image.labelStarts) labelStarts[std::string(label.first)] = label.second;
+        sourceLines.assign(image.sourceLines, image.sourceLines + image.lineCount);
+
+        currentDataAddress = image.dataEnd;
+        textEnd = image.textEnd;
+        PC = textEnd;
+        instructionSize = textEnd - 4;  // Store the address of the last instruction
+
+        decodeInstructions();
+        return true;
+    }
 
-            luiMachineCode = luiOpcode.to_string() + std::bitset<5>(0).to_string() + atBin.to_string() + upperImm.to_string();
+    // Decode every assembled word once so the executor never re-extracts fields or control signals
+    void decodeInstructions() {
+        decodedInstructions.clear();
+        decodedInstructions.reserve((instructionSize + 4 - 0x0100) / 4);
+        codePages.clear();
+        if (textEnd > 0x0100) codePages.mark(0x0100, textEnd - 1);
+        for (uint32_t address = 0x0100; address <= instructionSize; address += 4) {
+            decodedInstructions.push_back(decodeWord(fetchWord(address), address));
+        }
+    }
 
-            // push back the machine code into memoryAdd array starting from PC
-            memoryAdd[PC] = std::bitset<8>(std::stoi(luiMachineCode.substr(0, 8), nullptr, 2)).to_ulong();
-            memoryAdd[PC + 1] = std::bitset<8>(std::stoi(luiMachineCode.substr(8, 8), nullptr, 2)).to_ulong();
-            memoryAdd[PC + 2] = std::bitset<8>(std::stoi(luiMachineCode.substr(16, 8), nullptr, 2)).to_ulong();
-            memoryAdd[PC + 3] = std::bitset<8>(std::stoi(luiMachineCode.substr(24, 8), nullptr, 2)).to_ulong();
-            PC += 4;
+    // Reads an instruction word (stored most significant byte first)
+    uint32_t fetchWord(uint32_t address) {
+        return byteSwap(memory.readWord(address));
+    }
 
-            // Use lower 16 bits as offset for lw instruction
-            offset = lowerImmediate;
+    // Decodes the word located at address; branch and jump targets are resolved here
+    DecodedInstruction decodeWord(uint32_t instruction, uint32_t address) {
+        uint8_t opcode = (instruction >> 26) & 0x3F;  // 6-bit opcode
+        uint8_t funct = instruction & 0x3F;           // 6-bit function code
+        setControlSignal(opcode, funct);
+
+        DecodedInstruction decoded{};
+        decoded.raw = instruction;
+        decoded.signals = packControlSignals();
+        decoded.rs = (instruction >> 21) & 0x1F;
+        decoded.rt = (instruction >> 16) & 0x1F;
+        decoded.rd = RegDst.test(0) ? (instruction >> 11) & 0x1F : decoded.rt;
+
+        uint32_t immediate = instruction & 0xFFFF;
+        switch (opcode) {
+            case 0x00:  // R-type
+                switch (funct) {
+                    case 0x20: decoded.op = Op::Add; break;
+                    case 0x22: decoded.op = Op::Sub; break;
+                    case 0x24: decoded.op = Op::And; break;
+                    case 0x25: decoded.op = Op::Or; break;
+                    case 0x2A: decoded.op = Op::Slt; break;
+                    case 0x18: decoded.op = Op::Mult; break;
+                    case 0x1A: decoded.op = Op::Div; break;
+                    case 0x10: decoded.op = Op::Mfhi; break;
+                    case 0x12: decoded.op = Op::Mflo; break;
+                    case 0x08: decoded.op = Op::Jr; break;
+                    case 0x0C: decoded.op = Op::Syscall; break;
+                    default: decoded.op = Op::UnknownR; break;
+                }
+                break;
+            case 0x08:  // addi (immediate is not sign-extended by the ALU path)
+                decoded.op = Op::Addi;
+                decoded.imm = immediate;
+                break;
+            case 0x23:  // lw
+                decoded.op = Op::Lw;
+                decoded.imm = (immediate & 0x8000) ? (immediate | 0xFFFF0000) : immediate;
+                break;
+            case 0x2B:  // sw
+                decoded.op = Op::Sw;
+                decoded.imm = (immediate & 0x8000) ? (immediate | 0xFFFF0000) : immediate;
+                break;
+            case 0x04:  // beq
+                decoded.op = Op::Beq;
+                decoded.imm = address + (immediate << 2);
+                break;
+            case 0x02:  // j
+                decoded.op = Op::J;
+                decoded.imm = ((address + 4) & 0xF0000000) | ((instruction & 0x03FFFFFF) << 2);
+                break;
+            case 0x03:  // jal
+                decoded.op = Op::Jal;
+                decoded.imm = (instruction & 0x03FFFFFF) << 2;
+                break;
+            default:
+                decoded.op = Op::Nop;
+                break;
         }
+        return decoded;
+    }
 
-        // Ensure offset is a signed 16-bit number
-        if (offset > 32767 || offset < -32768) {
-            std::cerr << "Error: Offset value out of range for 16-bit signed integer." << std::endl;
-            exit(EXIT_FAILURE);
+    // Decoded instruction at address; words outside the assembled text are decoded on demand
+    const DecodedInstruction& decodedAt(uint32_t address) {
+        uint32_t index = (address - 0x0100) >> 2;
+        if ((address & 3) == 0 && index < decodedInstructions.size()) {
+            return decodedInstructions[index];
         }
-
-        // Create lw instruction
-        std::bitset<6> opcode(0b100011);    // Opcode for lw
-        std::bitset<5> baseBin(base);       // Base register binary value
-        std::bitset<5> rtBin(rt);           // Destination register binary value
-        std::bitset<16> offsetBin(offset);  // Offset value
-
-        std::string lwMachineCode = opcode.to_string() + baseBin.to_string() + rtBin.to_string() + offsetBin.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(lwMachineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(lwMachineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(lwMachineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(lwMachineCode.substr(24, 8), nullptr, 2)).to_ulong();
-        PC += 4;
-
-        // Combine lui and lw machine code
-        std::cout << "Machine Code: " << luiMachineCode << "\n"
-                  << "              " << lwMachineCode << std::endl
-                  << std::endl;
+        codePages.mark(address, address + 3);  // Stores here must now invalidate translations
+        scratchInstruction = decodeWord(fetchWord(address), address);
+        return scratchInstruction;
     }
 
-    void swToMachineCode(const std::string& reg1, const std::string& address) {
-        int rt = regToNumber(reg1);  // Source register (e.g., $t3)
-        int base, offset;
-        std::string luiMachineCode;  // Initialize for storing lui machine code
+    // Assembly listing is part of the per-instruction trace
+    bool listingEnabled() const { return Tracer<kMaxTraceLevel>(traceLevel).enabled(TraceLevel::Instruction); }
 
-        std::size_t openParen = address.find('(');
-        std::size_t closeParen = address.find(')');
+    // Encodes one instruction into instruction.size / 4 words. Only reads assembler state, so
+    // chunks can be encoded concurrently; errors are thrown as AssemblyError.
+    void encodeInstruction(const SourceInstruction& instruction, uint32_t* words) const {
+        LineTokenizer tokens(instruction.text);
+        std::string_view opcode, reg1, reg2, reg3;
 
-        if (openParen != std::string::npos && closeParen != std::string::npos) {
-            // Extract offset and base register for format "offset(base)"
-            try {
-                offset = std::stoi(address.substr(0, openParen));  // Get the offset part
-            } catch (const std::invalid_argument&) {
-                std::cerr << "Error: Invalid offset value in address: " << address << std::endl;
-                exit(EXIT_FAILURE);
-            }
+        tokens.next(opcode);  // Get the operation (e.g., lw, add, etc.)
+        tokens.next(reg1);    // Operands; the ones an instruction does not use stay empty
+        tokens.next(reg2);
+        tokens.next(reg3);
 
-            std::string baseReg = address.substr(openParen + 1, closeParen - openParen - 1);
-            base = regToNumber(baseReg);
-        } else {
-            // Otherwise, treat it as a variable name
-            if (symbolTable.find(address) == symbolTable.end()) {
-                std::cerr << "Error: Unknown variable '" << address << "'." << std::endl;
-                exit(EXIT_FAILURE);
+        switch (instruction.mnemonic) {
+            case Mnemonic::Lw:
+                memoryToMachineCode(Mnemonic::Lw, reg1, reg2, words);  // lw $t0, num1
+                break;
+            case Mnemonic::Sw:
+                memoryToMachineCode(Mnemonic::Sw, reg1, reg2, words);  // sw $t0, num1
+                break;
+            case Mnemonic::Add:
+                words[0] = encode(Mnemonic::Add, regToNumber(reg2), regToNumber(reg3), regToNumber(reg1), 0);  // add $t2, $t0, $t1
+                break;
+            case Mnemonic::Sub:
+                words[0] = encode(Mnemonic::Sub, regToNumber(reg2), regToNumber(reg3), regToNumber(reg1), 0);  // sub $t2, $t0, $t1
+                break;
+            case Mnemonic::Mult:
+                words[0] = encode(Mnemonic::Mult, regToNumber(reg1), regToNumber(reg2), 0, 0);  // mult $t2, $t0
+                break;
+            case Mnemonic::Div:
+                words[0] = encode(Mnemonic::Div, regToNumber(reg1), regToNumber(reg2), 0, 0);  // div $t2, $t0
+                break;
+            case Mnemonic::Mflo:
+                words[0] = encode(Mnemonic::Mflo, 0, 0, regToNumber(reg1), 0);  // mflo $t0
+                break;
+            case Mnemonic::Mfhi:
+                words[0] = encode(Mnemonic::Mfhi, 0, 0, regToNumber(reg1), 0);  // mfhi $t0
+                break;
+            case Mnemonic::Addi:
+                words[0] = encode(Mnemonic::Addi, regToNumber(reg2), regToNumber(reg1), 0, parseImmediate(reg3));  // addi $t2, $t0, 5
+                break;
+            case Mnemonic::And:
+                words[0] = encode(Mnemonic::And, regToNumber(reg2), regToNumber(reg3), regToNumber(reg1), 0);  // and $t2, $t0, $t1
+                break;
+            case Mnemonic::Or:
+                words[0] = encode(Mnemonic::Or, regToNumber(reg2), regToNumber(reg3), regToNumber(reg1), 0);  // or $t2, $t0, $t1
+                break;
+            case Mnemonic::Li:
+                words[0] = encode(Mnemonic::Li, 0, regToNumber(reg1), 0, parseImmediate(reg2));  // li $v0, 1
+                break;
+            case Mnemonic::Move:
+                words[0] = encode(Mnemonic::Move, regToNumber(reg2), 0, regToNumber(reg1), 0);  // move $a0, $t2
+                break;
+            case Mnemonic::Syscall:
+                words[0] = encode(Mnemonic::Syscall, 0, 0, 0, 0);
+                break;
+            case Mnemonic::Lwc1:  // lwc1 $f0, num1 (float registers that fail to parse encode as 31)
+                words[0] = encode(Mnemonic::Lwc1, kAssemblerTemporary, floatRegisterToBinary(reg1), 0, symbolAddress(reg2));
+                break;
+            case Mnemonic::Swc1:  // swc1 $f0, num1
+                words[0] = encode(Mnemonic::Swc1, kAssemblerTemporary, floatRegisterToBinary(reg1), 0, symbolAddress(reg2));
+                break;
+            case Mnemonic::AddS:  // add.s $f0, $f1, $f2
+                words[0] = encode(Mnemonic::AddS, floatRegisterToBinary(reg2), floatRegisterToBinary(reg3), floatRegisterToBinary(reg1), 0);
+                break;
+            case Mnemonic::J:
+                words[0] = jToMachineCode(reg1, instruction.address);  // j label
+                break;
+            case Mnemonic::Jr:
+                words[0] = encode(Mnemonic::Jr, regToNumber(reg1), 0, 0, 0);  // jr $ra
+                break;
+            case Mnemonic::Jal:
+                words[0] = encode(Mnemonic::Jal, 0, 0, 0, labelAddress(reg1) / 4);  // jal label
+                break;
+            case Mnemonic::Beq: {  // beq $t0, $t1, label
+                int offset = (static_cast<int>(labelAddress(reg3)) - static_cast<int>(instruction.address)) / 4 - 1;
+                words[0] = encode(Mnemonic::Beq, regToNumber(reg1), regToNumber(reg2), 0, offset);
+                break;
             }
-
-            base = regToNumber("$at");             // Base register is $at ($1)
-            int immediate = symbolTable[address];  // Full 32-bit address
-
-            int upperImmediate = (immediate >> 16) & 0xFFFF;  // Upper 16 bits
-            int lowerImmediate = immediate & 0xFFFF;          // Lower 16 bits
-
-            // Create the lui instruction
-            std::bitset<6> luiOpcode(0b001111);        // Opcode for 'lui'
-            std::bitset<5> atBin(regToNumber("$at"));  // $at register
-            std::bitset<16> upperImm(upperImmediate);
-
-            luiMachineCode = luiOpcode.to_string() + std::bitset<5>(0).to_string() + atBin.to_string() + upperImm.to_string();
-
-            // push back the machine code into memoryAdd array starting from PC
-            memoryAdd[PC] = std::bitset<8>(std::stoi(luiMachineCode.substr(0, 8), nullptr, 2)).to_ulong();
-            memoryAdd[PC + 1] = std::bitset<8>(std::stoi(luiMachineCode.substr(8, 8), nullptr, 2)).to_ulong();
-            memoryAdd[PC + 2] = std::bitset<8>(std::stoi(luiMachineCode.substr(16, 8), nullptr, 2)).to_ulong();
-            memoryAdd[PC + 3] = std::bitset<8>(std::stoi(luiMachineCode.substr(24, 8), nullptr, 2)).to_ulong();
-            PC += 4;
-
-            // Use lower 16 bits as offset for sw instruction
-            offset = lowerImmediate;
-        }
-
-        // Ensure offset is a signed 16-bit number
-        if (offset > 32767 || offset < -32768) {
-            std::cerr << "Error: Offset value out of range for 16-bit signed integer." << std::endl;
-            exit(EXIT_FAILURE);
+            case Mnemonic::La:
+                laToMachineCode(reg1, reg2, words);  // la $t0, num1
+                break;
+            case Mnemonic::Slt:
+                words[0] = encode(Mnemonic::Slt, regToNumber(reg2), regToNumber(reg3), regToNumber(reg1), 0);  // slt $t0, $t1, $t2
+                break;
+            default:
+                throw AssemblyError("Invalid instruction: " + std::string(opcode));
         }
-
-        // Create sw instruction
-        std::bitset<6> opcode(0b101011);    // Opcode for sw
-        std::bitset<5> baseBin(base);       // Base register binary value
-        std::bitset<5> rtBin(rt);           // Source register binary value
-        std::bitset<16> offsetBin(offset);  // Offset value
-
-        std::string swMachineCode = opcode.to_string() + baseBin.to_string() + rtBin.to_string() + offsetBin.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(swMachineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(swMachineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(swMachineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(swMachineCode.substr(24, 8), nullptr, 2)).to_ulong();
-        PC += 4;
-
-        // Combine lui and lw machine code
-        std::cout << "Machine Code: " << luiMachineCode << "\n"
-                  << "              " << swMachineCode << std::endl
-                  << std::endl;
     }
 
-    void subToMachineCode(const std::string& reg1, const std::string& reg2, const std::string& reg3) {
-        int rd = regToNumber(reg1);
-        int rs = regToNumber(reg2);
-        int rt = regToNumber(reg3);
-
-        std::bitset<6> opcode(0);  // R-type opcode is 0
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(rt);
-        std::bitset<5> rdBin(rd);
-        std::bitset<5> shamt(0);         // Shift amount is 0 for sub
-        std::bitset<6> funct(0b100010);  // Function code for sub
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // converts register name to number (e.g., $t0 or $8 -> 8)
+    int regToNumber(std::string_view reg) const {
+        int number;
+        if (!lookupRegister(reg, number)) throw AssemblyError("Unknown register: " + std::string(reg));
+        return number;
     }
 
-    void multToMachineCode(const std::string& reg1, const std::string& reg2) {
-        int rs = regToNumber(reg1);
-        int rt = regToNumber(reg2);
-
-        std::bitset<6> opcode(0);        // R-type opcode is 0
-        std::bitset<5> rsBin(rs);        // Source register 1
-        std::bitset<5> rtBin(rt);        // Source register 2
-        std::bitset<5> rdBin(0);         // Destination register (not used for mult)
-        std::bitset<5> shamt(0);         // Shift amount is 0
-        std::bitset<6> funct(0b011000);  // Function code for mult
-
-        // Concatenate all parts to form the machine code
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // Converts number to register name (e.g., 8 -> $t0)
+    std::string_view numberToReg(int reg) const {
+        if (reg < 0 || reg >= 32) return "";
+        return kRegisterNames[reg];
     }
 
-    void divToMachineCode(const std::string& reg1, const std::string& reg2) {
-        int rs = regToNumber(reg1);  // Source register
-        int rt = regToNumber(reg2);  // Target register
-        std::bitset<6> opcode(0);    // R-type opcode is 0
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(rt);
-        std::bitset<5> rdBin(0);         // Destination register is 0 for div
-        std::bitset<5> shamt(0);         // Shift amount is 0
-        std::bitset<6> funct(0b011010);  // Function code for div
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    int floatRegisterToBinary(std::string_view reg) const {
+        int regNum;
+        if (reg.size() > 1 && reg[0] == 'f' && parseInteger(reg.substr(1), regNum)) {
+            if (regNum >= 0 && regNum <= 31) {
+                return regNum;
+            }
+        }
+        return -1;
     }
 
-    void mfloToMachineCode(const std::string& reg1) {
-        int rd = regToNumber(reg1);      // Destination register
-        std::bitset<6> opcode(0);        // R-type opcode is 0
-        std::bitset<5> rsBin(0);         // No source register
-        std::bitset<5> rtBin(0);         // No target register
-        std::bitset<5> rdBin(rd);        // Destination register
-        std::bitset<5> shamt(0);         // Shift amount is 0
-        std::bitset<6> funct(0b010010);  // Function code for mflo
-
-        // Concatenate to form machine code
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // Decimal immediate operand
+    int parseImmediate(std::string_view text) const {
+        int value;
+        if (!parseInteger(text, value)) throw AssemblyError("Invalid immediate value: " + std::string(text));
+        return value;
     }
 
-    void mfhiToMachineCode(const std::string& reg1) {
-        int rd = regToNumber(reg1);      // Destination register
-        std::bitset<6> opcode(0);        // R-type opcode is 0
-        std::bitset<5> rsBin(0);         // No source register
-        std::bitset<5> rtBin(0);         // No target register
-        std::bitset<5> rdBin(rd);        // Destination register
-        std::bitset<5> shamt(0);         // Shift amount is 0
-        std::bitset<6> funct(0b010000);  // Function code for mfhi
-
-        // Concatenate to form machine code
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // True for a memory operand written as offset(base); anything else names a variable
+    static bool isBaseOffset(std::string_view address) {
+        return address.find('(') != std::string_view::npos && address.find(')') != std::string_view::npos;
     }
 
-    void andToMachineCode(const std::string& reg1, const std::string& reg2, const std::string& reg3) {
-        int rd = regToNumber(reg1);
-        int rs = regToNumber(reg2);
-        int rt = regToNumber(reg3);
-
-        std::bitset<6> opcode(0);  // R-type opcode is 0
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(rt);
-        std::bitset<5> rdBin(rd);
-        std::bitset<5> shamt(0);         // Shift amount is 0 for and
-        std::bitset<6> funct(0b100100);  // Function code for and
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // Writes an instruction word (most significant byte first)
+    void storeInstructionWord(uint32_t address, uint32_t word) {
+        memory.writeWord(address, byteSwap(word));
     }
 
-    void orToMachineCode(const std::string& reg1, const std::string& reg2, const std::string& reg3) {
-        int rd = regToNumber(reg1);
-        int rs = regToNumber(reg2);
-        int rt = regToNumber(reg3);
-
-        std::bitset<6> opcode(0);  // R-type opcode is 0
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(rt);
-        std::bitset<5> rdBin(rd);
-        std::bitset<5> shamt(0);         // Shift amount is 0 for or
-        std::bitset<6> funct(0b100101);  // Function code for or
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // Assembly listing of one instruction. lw, sw and la always use the two-line layout,
+    // whose first line is blank when there is no lui.
+    void listInstruction(const SourceInstruction& instruction, const uint32_t* words) const {
+        if (!listingEnabled()) return;
+        std::cout << "Assembly: " << instruction.text << std::endl;
+        if (instruction.mnemonic == Mnemonic::Lw || instruction.mnemonic == Mnemonic::Sw || instruction.mnemonic == Mnemonic::La) {
+            bool hasUpper = instruction.size == 8;
+            std::cout << "Machine Code: " << (hasUpper ? std::bitset<32>(words[0]).to_string() : "") << "\n"
+                      << "              " << std::bitset<32>(words[hasUpper ? 1 : 0]) << std::endl
+                      << std::endl;
+        } else {
+            std::cout << "Machine Code: " << std::bitset<32>(words[0]) << std::endl
+                      << std::endl;
+        }
     }
 
-    void liToMachineCode(const std::string& reg1, const std::string& value) {
-        int immediate = std::stoi(value);
-        int rt = regToNumber(reg1);
-
-        std::bitset<6> opcode(0b001001);  // addi opcode
-        std::bitset<5> rs(0);             // $zero register
-        std::bitset<5> rtBin(rt);
-        std::bitset<16> imm(immediate);
-
-        std::string machineCode = opcode.to_string() + rs.to_string() + rtBin.to_string() + imm.to_string();
+    // Encodes lw/sw. A variable operand becomes "lui $at, upper" followed by "op rt, lower($at)".
+    void memoryToMachineCode(Mnemonic mnemonic, std::string_view reg1, std::string_view address, uint32_t* words) const {
+        int rt = regToNumber(reg1);  // Destination (lw) or source (sw) register
+        int base, offset;
 
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
+        if (isBaseOffset(address)) {
+            // Extract offset and base register for format "offset(base)"
+            std::size_t openParen = address.find('(');
+            std::size_t closeParen = address.find(')');
+            if (!parseInteger(address.substr(0, openParen), offset)) {  // Get the offset part
+                throw AssemblyError("Invalid offset value in address: " + std::string(address));
+            }
 
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
-    }
+            std::string_view baseReg = address.substr(openParen + 1, closeParen - openParen - 1);
+            base = regToNumber(baseReg);
+        } else {
+            // Otherwise, treat it as a variable name
+            auto symbol = symbolTable.find(std::string(address));
+            if (symbol == symbolTable.end()) throw AssemblyError("Unknown variable '" + std::string(address) + "'.");
 
-    void moveToMachineCode(const std::string& reg1, const std::string& reg2) {
-        int rd = regToNumber(reg1);
-        int rs = regToNumber(reg2);
+            base = kAssemblerTemporary;           // Base register is $at ($1)
+            uint32_t immediate = symbol->second;  // Full 32-bit address
 
-        std::bitset<6> opcode(0);  // R-type opcode is 0
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(0);
-        std::bitset<5> rdBin(rd);
-        std::bitset<5> shamt(0);         // Shift amount is 0 for add
-        std::bitset<6> funct(0b100000);  // Function code for add
+            *words++ = encode(Mnemonic::Lui, 0, base, 0, immediate >> 16);
 
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
+            // Use lower 16 bits as offset
+            offset = immediate & 0xFFFF;
+        }
 
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
+        // Ensure offset is a signed 16-bit number
+        if (offset > 32767 || offset < -32768) throw AssemblyError("Offset value out of range for 16-bit signed integer.");
 
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+        *words = encode(mnemonic, base, rt, 0, offset);
     }
 
-    void syscallToMachineCode() {
-        std::string machineCode = "00000000000000000000000000001100";  // Machine code for syscall
+    uint32_t jToMachineCode(std::string_view label, uint32_t address) const {
+        // Get the absolute address of the target
+        uint32_t absoluteTarget = labelAddress(label);
 
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
+        // The target field holds bits 27..2 of the destination; the upper 4 bits of (PC + 4) are
+        // folded into the lowest bits, as the assembler always has (they are 0 for this memory size)
+        uint32_t pcNext = (address + 4) & 0xF0000000;
+        uint32_t target = ((absoluteTarget & 0x0FFFFFFF) >> 2) | (pcNext >> 28);
 
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+        return encode(Mnemonic::J, 0, 0, 0, target);
     }
 
-    void lwc1ToMachineCode(std::string reg1, std::string reg2) {
-        int ft = floatRegisterToBinary(reg1);
-        int base = regToNumber("$at");
-        int offset = symbolTable[reg2];
-
-        std::bitset<6> opcode(0b110001);  // Opcode for lwc1
-        std::bitset<5> baseBin(base);
-        std::bitset<5> ftBin(ft);
-        std::bitset<16> offsetBin(offset);
-
-        std::string machineCode = opcode.to_string() + baseBin.to_string() + ftBin.to_string() + offsetBin.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
+    // la expands to "lui rt, upper" followed by "addi rt, rt, lower"
+    void laToMachineCode(std::string_view reg1, std::string_view address, uint32_t* words) const {
+        int rt = regToNumber(reg1);
+        uint32_t immediate = symbolAddress(address);
 
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+        words[0] = encode(Mnemonic::Lui, 0, rt, 0, immediate >> 16);
+        words[1] = encode(Mnemonic::Addi, rt, rt, 0, immediate);
     }
 
-    void swc1ToMachineCode(std::string reg1, std::string reg2) {
-        int ft = floatRegisterToBinary(reg1);
-        int base = regToNumber("$at");
-        int offset = symbolTable[reg2];
-
-        std::bitset<6> opcode(0b111001);  // Opcode for swc1
-        std::bitset<5> baseBin(base);
-        std::bitset<5> ftBin(ft);
-        std::bitset<16> offsetBin(offset);
-
-        std::string machineCode = opcode.to_string() + baseBin.to_string() + ftBin.to_string() + offsetBin.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // Address of a .data variable, 0 when it is undefined
+    uint32_t symbolAddress(std::string_view name) const {
+        auto it = symbolTable.find(std::string(name));
+        return it == symbolTable.end() ? 0 : it->second;
     }
 
-    void addSToMachineCode(std::string reg1, std::string reg2, std::string reg3) {
-        int fd = floatRegisterToBinary(reg1);
-        int fs = floatRegisterToBinary(reg2);
-        int ft = floatRegisterToBinary(reg3);
-
-        std::bitset<6> opcode(0);  // Opcode for add.s
-        std::bitset<5> fsBin(fs);
-        std::bitset<5> ftBin(ft);
-        std::bitset<5> fdBin(fd);
-        std::bitset<5> shamt(0);         // Shift amount is 0
-        std::bitset<6> funct(0b000000);  // Function code for add.s
-
-        std::string machineCode = opcode.to_string() + fsBin.to_string() + ftBin.to_string() + fdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // Address of a .text label, 0 when it is undefined
+    uint32_t labelAddress(std::string_view label) const {
+        auto it = funcMap.find(std::string(label));
+        return it == funcMap.end() ? 0 : it->second;
     }
 
-    void jToMachineCode(const std::string& label) {
-        // Get the absolute address of the target
-        uint32_t absoluteTarget = funcMap[label];
-
-        // Calculate the jump target
-        // We need the 4 most significant bits of (PC + 4) and the 26 least significant bits of the target address
-        uint32_t pcNext = (PC + 4) & 0xF0000000;                                  // Get the 4 most significant bits of (PC + 4)
-        uint32_t target = ((absoluteTarget & 0x0FFFFFFF) >> 2) | (pcNext >> 28);  // Get the 26 least significant bits and shift right by 2
-
-        std::bitset<6> opcode(0b000010);  // Opcode for j
-        std::bitset<26> targetBin(target);
-
-        std::string machineCode = opcode.to_string() + targetBin.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+    // Runs the program at the runtime trace level; levels above kMaxTraceLevel are compiled out
+    void executeInstructions() {
+        instructionCache.resetStats();
+        dataCache.resetStats();
+        instructionCount = 0;
+        fetchStallCycles = 0;
+        dataStallCycles = 0;
+        pipeline.reset();
+        outOfOrderCore.reset();
+        branchUnit.reset();
+        if (profiling) profiler.start(textEnd, labelStarts);
+        workloadStats.reset();
+        if (engine == Engine::Threaded) {
+            executeThreaded();
+        } else if (engine == Engine::Block) {
+            executeBlocks();
+        } else if (engine == Engine::Jit) {
+            executeJit();
+        } else if (traceLevel == TraceLevel::Off) {
+            executeInstructions<TraceLevel::Off>();  // No trace code in the loop at all
+        } else {
+            executeInstructions<kMaxTraceLevel>();
+        }
     }
 
-    void jrToMachineCode(const std::string& reg1) {
-        int rs = regToNumber(reg1);
-
-        std::bitset<6> opcode(0);  // R-type opcode is 0
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(0);         // No target register
-        std::bitset<5> rdBin(0);         // No destination register
-        std::bitset<5> shamt(0);         // Shift amount is 0
-        std::bitset<6> funct(0b001000);  // Function code for jr
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
+    template <TraceLevel MaxLevel>
+    void executeInstructions() {
+        const Tracer<MaxLevel> trace(traceLevel);
+        running = true;
+        PC = 0x0100;  // Start at address 0x0100
 
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
-    }
+        while (running) {
+            // Check if the program counter is within bounds of instructionSize
+            if (PC > instructionSize) {
+                if (trace.enabled(TraceLevel::Summary)) std::cout << "-- program is finished running (dropped off bottom) --" << std::endl;
+                running = false;
+                break;
+            }
+            instructionCount++;
+
+            if (trace.enabled(TraceLevel::Instruction)) std::cout << "\n----------------------------------------" << std::endl;
+            // The instruction cache models the fetch; the operation itself comes from the decoded stream
+            const DecodedInstruction& decoded = decodedAt(PC);
+            uint32_t fetchPC = PC;
+            if (profiling) profiler.execute(decoded, PC);
+            if (collectingStats) workloadStats.countInstruction(decoded, PC);
+            uint32_t fetchStall = hierarchy.access(instructionCache, PC, false) - 1;  // A miss fills the line from below
+            fetchStallCycles += fetchStall;
+            if (pipelined) pipeline.fetch(decoded, PC, fetchStall);
+            if (outOfOrder) outOfOrderCore.fetch(decoded, PC, fetchStall);
+
+            if (trace.enabled(TraceLevel::Instruction)) {
+                std::cout << "Instruction: " << std::bitset<32>(decoded.raw) << std::endl;
+                std::cout << "Initial PC: " << PC << std::endl;
+            }
+            if (trace.enabled(TraceLevel::Signal)) {
+                std::cout << "Opcode: " << std::bitset<8>((decoded.raw >> 26) & 0x3F) << std::endl;
+                printControlSignals(decoded.signals);
+            }
 
-    void jalToMachineCode(const std::string& label) {
-        int target = funcMap[label] / 4;  // Calculate the target address
+            uint8_t rs = decoded.rs;
+            uint8_t rt = decoded.rt;
+            uint8_t rd = decoded.rd;
+            if (trace.enabled(TraceLevel::Instruction)) {
+                std::cout << "rs: ";
+                printRegisterValue(rs);
+                std::cout << "rt: ";
+                printRegisterValue(rt);
+                std::cout << "rd: ";
+                printRegisterValue(rd);
+            }
+            if (trace.enabled(TraceLevel::Signal)) {
+                uint32_t readRegister2 = (decoded.signals & kALUSrc) ? (decoded.raw & 0xFFFF) : registers[rt];
+                std::cout << "ALUResult: " << std::bitset<32>(ALUOperation(decoded.signals, registers[rs], readRegister2, decoded.raw & 0x3F)) << std::endl;
+            }
 
-        std::bitset<6> opcode(0b000011);  // Opcode for jal
-        std::bitset<26> targetBin(target);
+            switch (decoded.op) {
+                case Op::Add:
+                    writeRegister(trace, decoded, registers[rs] + registers[rt]);
+                    PC += 4;
+                    break;
+                case Op::Sub:
+                    writeRegister(trace, decoded, registers[rs] - registers[rt]);
+                    PC += 4;
+                    break;
+                case Op::And:
+                    writeRegister(trace, decoded, registers[rs] & registers[rt]);
+                    PC += 4;
+                    break;
+                case Op::Or:
+                    writeRegister(trace, decoded, registers[rs] | registers[rt]);
+                    PC += 4;
+                    break;
+                case Op::Slt:
+                    writeRegister(trace, decoded, (int32_t)registers[rs] < (int32_t)registers[rt] ? 1 : 0);
+                    PC += 4;
+                    break;
+                case Op::Mult:
+                case Op::Div:
+                case Op::Mfhi:
+                case Op::Mflo:
+                case Op::UnknownR:
+                    std::cerr << "Unknown R-type ALU operation" << std::endl;
+                    writeRegister(trace, decoded, 0);
+                    PC += 4;
+                    break;
+                case Op::Addi:
+                    writeRegister(trace, decoded, registers[rs] + decoded.imm);
+                    PC += 4;
+                    break;
+                case Op::Lw: {
+                    uint32_t address = registers[rs] + decoded.imm;
+                    uint32_t memData = readMemory(address);
+                    if (trace.enabled(TraceLevel::Instruction)) {
+                        std::cout << "Memory Data: " << std::bitset<32>(memData) << std::endl;
+                        std::cout << "Initial Register Values:" << std::endl;
+                        printRegisterValue(rs);
+                        printRegisterValue(rd);
+                    }
+                    registers[rd] = memData;
+                    if (trace.enabled(TraceLevel::Instruction)) {
+                        std::cout << "Final Register Values:" << std::endl;
+                        printRegisterValue(rs);
+                        printRegisterValue(rd);
+                    }
+                    PC += 4;
+                    break;
+                }
+                case Op::Sw: {
+                    uint32_t address = registers[rs] + decoded.imm;  // Final memory address
+                    uint32_t value = registers[rt];                  // The value from register[rt]
+
+                    // Print initial memory values
+                    if (trace.enabled(TraceLevel::Instruction)) {
+                        std::cout << "Initial Memory Value:" << std::endl;
+                        printWord(address);
+                    }
 
-        std::string machineCode = opcode.to_string() + targetBin.to_string();
+                    accessData(address, true);
+                    storeWord(address, value);
 
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
+                    // Print Final memory values
+                    if (trace.enabled(TraceLevel::Instruction)) {
+                        std::cout << "Final Memory Value:" << std::endl;
+                        printWord(address);
+                    }
 
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
-    }
+                    PC += 4;
+                    continue;  // The sw trace has no final PC line
+                }
+                case Op::Beq:
+                    PC = registers[rs] == registers[rt] ? decoded.imm : PC + 4;
+                    break;
+                case Op::J:
+                    PC = decoded.imm;
+                    break;
+                case Op::Jal:
+                    if (trace.enabled(TraceLevel::Instruction)) {
+                        std::cout << "Initial Register Values:" << std::endl;
+                        printRegisterValue(31);
+                    }
+                    registers[31] = PC + 4;
+                    if (trace.enabled(TraceLevel::Instruction)) {
+                        std::cout << "Final Register Values:" << std::endl;
+                        printRegisterValue(31);
+                    }
+                    PC = decoded.imm;
+                    break;
+                case Op::Jr:
+                    PC = registers[31];  // jr always returns through $ra
+                    break;
+                case Op::Syscall:
+                    PC += 4;
+                    executeSyscall(trace);
+                    break;
+                case Op::Nop:
+                    PC += 4;
+                    break;
+            }
 
-    void beqToMachineCode(const std::string& reg1, const std::string& reg2, const std::string& label) {
-        int rs = regToNumber(reg1);
-        int rt = regToNumber(reg2);
-        int labelAddress = funcMap[label];                    // Get the address of the label
-        int offset = (labelAddress - PC) / 4 - 1;             // Calculate the offset
-        int16_t signedOffset = static_cast<int16_t>(offset);  // Ensure 16-bit signed representation
-
-        std::bitset<6> opcode(0b000100);  // Opcode for beq
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(rt);
-        std::bitset<16> offsetBin(static_cast<uint16_t>(signedOffset));  // Convert to bitset
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + offsetBin.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+            if (collectingStats && decoded.op == Op::Beq) workloadStats.countBranch(PC != fetchPC + 4);
+            if (predicting) {
+                bool correct = branchUnit.resolve(decoded, fetchPC, PC);
+                if (pipelined) pipeline.predicted(correct);
+                if (outOfOrder) outOfOrderCore.predicted(correct);
+            }
+            if (trace.enabled(TraceLevel::Instruction)) std::cout << "Final PC: " << PC << std::endl;
+        }
+        hierarchy.flush(dataCache);  // Write back the dirty lines left at exit
+        if (pipelined) pipeline.drain();
+        if (outOfOrder) outOfOrderCore.drain();
     }
 
-    void laToMachineCode(const std::string& reg1, const std::string& address) {
-        int rt = regToNumber(reg1);
-        int immediate = symbolTable[address];
-
-        // Split the address into upper and lower 16 bits
-        int upperImmediate = (immediate >> 16) & 0xFFFF;  // Upper 16 bits
-        int lowerImmediate = immediate & 0xFFFF;          // Lower 16 bits
-
-        // Construct lui instruction (load upper immediate)
-        std::bitset<6> luiOpcode(0b001111);  // opcode for 'lui'
-        std::bitset<5> rtBin(rt);            // register
-        std::bitset<16> upperImm(upperImmediate);
-
-        // Machine code for 'lui'
-        std::string luiMachineCode = luiOpcode.to_string() + std::bitset<5>(0).to_string() + rtBin.to_string() + upperImm.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(luiMachineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(luiMachineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(luiMachineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(luiMachineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        PC += 4;
-
-        // Construct addi/ori instruction (load lower immediate)
-        std::bitset<6> addiOpcode(0b001000);  // opcode for 'addi' (could use ori instead)
-        std::bitset<16> lowerImm(lowerImmediate);
-
-        // Machine code for 'addi' (or 'ori')
-        std::string addiMachineCode = addiOpcode.to_string() + rtBin.to_string() + rtBin.to_string() + lowerImm.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(addiMachineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(addiMachineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(addiMachineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(addiMachineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        PC += 4;
-
-        // Combine the two machine codes
-        std::cout << "Machine Code: " << luiMachineCode + "\n" + "              " + addiMachineCode << std::endl
-                  << std::endl;
-    }
+    // Direct-threaded engine: every operation has its own handler and each handler dispatches
+    // the next one itself. Uses GCC labels-as-values when available and a switch otherwise.
+    // Functional only: no cache model and no per-instruction trace.
+    void executeThreaded() {
+        const Tracer<TraceLevel::Summary> trace(traceLevel);
+        const DecodedInstruction* decoded = nullptr;
+        running = true;
+        PC = 0x0100;  // Start at address 0x0100
 
-    void sltToMachineCode(const std::string& reg1, const std::string& reg2, const std::string& reg3) {
-        int rd = regToNumber(reg1);
-        int rs = regToNumber(reg2);
-        int rt = regToNumber(reg3);
-
-        std::bitset<6> opcode(0);  // R-type opcode is 0
-        std::bitset<5> rsBin(rs);
-        std::bitset<5> rtBin(rt);
-        std::bitset<5> rdBin(rd);
-        std::bitset<5> shamt(0);         // Shift amount is 0 for slt
-        std::bitset<6> funct(0b101010);  // Function code for slt
-
-        std::string machineCode = opcode.to_string() + rsBin.to_string() + rtBin.to_string() + rdBin.to_string() + shamt.to_string() + funct.to_string();
-
-        // push back the machine code into memoryAdd array starting from PC
-        memoryAdd[PC] = std::bitset<8>(std::stoi(machineCode.substr(0, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 1] = std::bitset<8>(std::stoi(machineCode.substr(8, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 2] = std::bitset<8>(std::stoi(machineCode.substr(16, 8), nullptr, 2)).to_ulong();
-        memoryAdd[PC + 3] = std::bitset<8>(std::stoi(machineCode.substr(24, 8), nullptr, 2)).to_ulong();
-
-        std::cout << "Machine Code: " << machineCode << std::endl
-                  << std::endl;
-        PC += 4;
+#if defined(__GNUC__) && !defined(MIPS_NO_COMPUTED_GOTO)
+        // Handler addresses in Op order
+        static const void* const handlers[] = {
+            &&op_Add, &&op_Sub, &&op_And, &&op_Or, &&op_Slt, &&op_Mult, &&op_Div, &&op_Mfhi, &&op_Mflo, &&op_UnknownR,
+            &&op_Jr, &&op_Syscall, &&op_Addi, &&op_Lw, &&op_Sw, &&op_Beq, &&op_J, &&op_Jal, &&op_Nop};
+        static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(Op::Nop) + 1, "missing handler");
+
+        // Threaded code: the handler address of every decoded text word
+        std::vector<const void*> threadedCode(decodedInstructions.size());
+        auto thread = [&]() {
+            for (size_t i = 0; i < decodedInstructions.size(); i++) {
+                threadedCode[i] = handlers[static_cast<uint8_t>(decodedInstructions[i].op)];
+            }
+        };
+        thread();
+
+#define THREADED_CASE(name) op_##name:
+#define THREADED_NEXT()                                                   \
+    do {                                                                  \
+        if (PC > instructionSize) goto finished;                          \
+        instructionCount++;                                               \
+        uint32_t index = (PC - 0x0100) >> 2;                              \
+        if ((PC & 3) == 0 && index < threadedCode.size()) {               \
+            decoded = &decodedInstructions[index];                        \
+            goto* threadedCode[index];                                    \
+        }                                                                 \
+        decoded = &decodedAt(PC);                                         \
+        goto* handlers[static_cast<uint8_t>(decoded->op)];                \
+    } while (0)
+#define THREADED_RETHREAD() thread()
+
+        THREADED_NEXT();
+#else
+        auto thread = []() {};
+#define THREADED_CASE(name) case Op::name:
+#define THREADED_NEXT() continue
+#define THREADED_RETHREAD() thread()
+
+        for (;;) {
+            if (PC > instructionSize) goto finished;
+            instructionCount++;
+            decoded = &decodedAt(PC);
+            switch (decoded->op) {
+#endif
+        THREADED_CASE(Add) {
+            registers[decoded->rd] = registers[decoded->rs] + registers[decoded->rt];
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Sub) {
+            registers[decoded->rd] = registers[decoded->rs] - registers[decoded->rt];
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(And) {
+            registers[decoded->rd] = registers[decoded->rs] & registers[decoded->rt];
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Or) {
+            registers[decoded->rd] = registers[decoded->rs] | registers[decoded->rt];
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Slt) {
+            registers[decoded->rd] = (int32_t)registers[decoded->rs] < (int32_t)registers[decoded->rt] ? 1 : 0;
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Mult)
+        THREADED_CASE(Div)
+        THREADED_CASE(Mfhi)
+        THREADED_CASE(Mflo)
+        THREADED_CASE(UnknownR) {
+            std::cerr << "Unknown R-type ALU operation" << std::endl;
+            registers[decoded->rd] = 0;
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Jr) {
+            PC = registers[31];  // jr always returns through $ra
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Syscall) {
+            PC += 4;
+            executeSyscall(trace);
+            if (!running) goto stopped;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Addi) {
+            registers[decoded->rd] = registers[decoded->rs] + decoded->imm;
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Lw) {
+            registers[decoded->rd] = loadWord(registers[decoded->rs] + decoded->imm);
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Sw) {
+            if (storeWord(registers[decoded->rs] + decoded->imm, registers[decoded->rt])) {
+                THREADED_RETHREAD();  // The store rewrote part of the text segment
+            }
+            PC += 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Beq) {
+            PC = registers[decoded->rs] == registers[decoded->rt] ? decoded->imm : PC + 4;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(J) {
+            PC = decoded->imm;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Jal) {
+            registers[31] = PC + 4;
+            PC = decoded->imm;
+            THREADED_NEXT();
+        }
+        THREADED_CASE(Nop) {
+            PC += 4;
+            THREADED_NEXT();
+        }
+#if !defined(__GNUC__) || defined(MIPS_NO_COMPUTED_GOTO)
+            }
+        }
+#endif
+#undef THREADED_CASE
+#undef THREADED_NEXT
+#undef THREADED_RETHREAD
+
+    finished:
+        if (trace.enabled(TraceLevel::Summary)) std::cout << "-- program is finished running (dropped off bottom) --" << std::endl;
+    stopped:
+        running = false;
     }
 
-    void executeInstructions() {
+    // Block engine: runs translated basic blocks and follows chained exits between them.
+    // Functional only: no cache model and no per-instruction trace.
+    void executeBlocks() {
+        const Tracer<TraceLevel::Summary> trace(traceLevel);
+        blockCache.reset(instructionSize);
         running = true;
         PC = 0x0100;  // Start at address 0x0100
 
+        TranslatedBlock* block = nullptr;
         while (running) {
-            // Check if the program counter is within bounds of instructionSize
             if (PC > instructionSize) {
-                std::cout << "-- program is finished running (dropped off bottom) --" << std::endl;
+                if (trace.enabled(TraceLevel::Summary)) std::cout << "-- program is finished running (dropped off bottom) --" << std::endl;
                 running = false;
                 break;
             }
-
-            std::cout << "\n----------------------------------------" << std::endl;
-            // Fetch the instruction from memory
-            std::cout << "Instruction Cache:" << std::endl;
-            uint32_t instruction = instructionCache.get(PC);
-            if (instruction == UINT32_MAX) {  // Cache miss; fetch from RAM
-                instruction = (static_cast<uint32_t>(memoryAdd[PC]) << 24) |
-                              (static_cast<uint32_t>(memoryAdd[PC + 1]) << 16) |
-                              (static_cast<uint32_t>(memoryAdd[PC + 2]) << 8) |
-                              (static_cast<uint32_t>(memoryAdd[PC + 3]));
-                instructionCache.put(PC, instruction);
+            if (block == nullptr) block = blockCache.lookup(PC);
+
+            int exit = 1;  // Successor slot taken by this block's exit
+            for (const BlockOp* op = block->ops.data();; op++) {
+                switch (op->kind) {
+                    case BlockOpKind::Add:
+                        registers[op->rd] = registers[op->rs] + registers[op->rt];
+                        continue;
+                    case BlockOpKind::Sub:
+                        registers[op->rd] = registers[op->rs] - registers[op->rt];
+                        continue;
+                    case BlockOpKind::And:
+                        registers[op->rd] = registers[op->rs] & registers[op->rt];
+                        continue;
+                    case BlockOpKind::Or:
+                        registers[op->rd] = registers[op->rs] | registers[op->rt];
+                        continue;
+                    case BlockOpKind::Slt:
+                        registers[op->rd] = (int32_t)registers[op->rs] < (int32_t)registers[op->rt] ? 1 : 0;
+                        continue;
+                    case BlockOpKind::AddImm:
+                        registers[op->rd] = registers[op->rs] + op->imm;
+                        continue;
+                    case BlockOpKind::ClearReg:
+                        std::cerr << "Unknown R-type ALU operation" << std::endl;
+                        registers[op->rd] = 0;
+                        continue;
+                    case BlockOpKind::Load:
+                        registers[op->rd] = loadWord(registers[op->rs] + op->imm);
+                        continue;
+                    case BlockOpKind::Store: {
+                        uint32_t executed = (op->pc - block->startPC) / 4 + 1;
+                        uint32_t nextPC = op->pc + 4;
+                        if (!storeWord(registers[op->rs] + op->imm, registers[op->rt])) continue;
+                        // Self-modifying store: the block may be gone, leave it right away
+                        instructionCount += executed;
+                        PC = nextPC;
+                        block = nullptr;
+                        break;
+                    }
+                    case BlockOpKind::Beq:
+                        if (registers[op->rs] == registers[op->rt]) {
+                            PC = op->imm;
+                            exit = 0;
+                        } else {
+                            PC = op->pc + 4;
+                        }
+                        break;
+                    case BlockOpKind::J:
+                        PC = op->imm;
+                        exit = 0;
+                        break;
+                    case BlockOpKind::Jal:
+                        registers[31] = op->pc + 4;
+                        PC = op->imm;
+                        exit = 0;
+                        break;
+                    case BlockOpKind::Jr:
+                        PC = registers[31];  // jr always returns through $ra
+                        exit = 0;
+                        break;
+                    case BlockOpKind::Syscall:
+                        PC = op->pc + 4;
+                        executeSyscall(trace);
+                        break;
+                    case BlockOpKind::Fallthrough:
+                        PC = op->imm;
+                        break;
+                }
+                break;
             }
+            if (block == nullptr) continue;  // Left early after a store into the text segment
+            instructionCount += block->instructionCount;
+
+            // Follow the chain, linking the exit on first use; jr targets are re-checked every time
+            TranslatedBlock* next = block->successors[exit];
+            if (next == nullptr || next->startPC != PC) {
+                next = PC <= instructionSize ? blockCache.lookup(PC) : nullptr;
+                block->successors[exit] = next;
+            }
+            block = next;
+        }
 
-            std::cout << "Instruction: " << std::bitset<32>(instruction) << std::endl;
-            std::cout << "Initial PC: " << PC << std::endl;
-
-            // Extract opcode and set control signals
-            uint8_t opcode = (instruction >> 26) & 0x3F;  // 6-bit opcode
-            std::cout << "Opcode: " << std::bitset<8>(opcode) << std::endl;
-
-            uint8_t funct = instruction & 0x3F;  // 6-bit function code
-            setControlSignal(opcode, funct);
+        if (trace.enabled(TraceLevel::Summary)) {
+            std::cout << "Block cache: " << blockCache.translations() << " blocks translated, " << blockCache.invalidations() << " invalidated" << std::endl;
+        }
+    }
 
-            // Extract register fields
-            uint8_t rs = (instruction >> 21) & 0x1F;                        // Source register 1
-            uint8_t rt = (instruction >> 16) & 0x1F;                        // Source register 2 or destination
-            uint8_t rd = RegDst.test(0) ? (instruction >> 11) & 0x1F : rt;  // Destination register
+    // JIT engine: hot blocks run as host code, everything else one instruction at a time.
+    // Functional only: no cache model and no per-instruction trace.
+    void executeJit() {
+        if (!JitCompiler::available()) {
+            std::cerr << "JIT not available on this host, using the block engine" << std::endl;
+            executeBlocks();
+            return;
+        }
+        const Tracer<TraceLevel::Summary> trace(traceLevel);
+        JitContext context = startJit();
 
-            std::cout << "rs: " << numberToReg(rs) << ": " << std::bitset<32>(registers[rs]) << " ( " << registers[rs] << " )" << std::endl;
-            std::cout << "rt: " << numberToReg(rt) << ": " << std::bitset<32>(registers[rt]) << " ( " << registers[rt] << " )" << std::endl;
-            std::cout << "rd: " << numberToReg(rd) << ": " << std::bitset<32>(registers[rd]) << " ( " << registers[rd] << " )" << std::endl;
+        while (running) {
+            if (PC > instructionSize) {
+                if (trace.enabled(TraceLevel::Summary)) std::cout << "-- program is finished running (dropped off bottom) --" << std::endl;
+                running = false;
+                break;
+            }
+            instructionCount += runJitStep(context, trace);
+        }
 
-            // Read from the registers
-            uint32_t readRegister1 = registers[rs];
-            uint32_t readRegister2 = ALUSrc.test(0) ? (instruction & 0xFFFF) : registers[rt];
+        if (trace.enabled(TraceLevel::Summary)) std::cout << "JIT: " << jit.compiledBlocks() << " blocks compiled" << std::endl;
+    }
 
-            // Perform ALU operation
-            uint32_t ALUResult = ALUOperation(readRegister1, readRegister2, funct);
-            std::cout << "ALUResult: " << std::bitset<32>(ALUResult) << std::endl;
+    // Runs the JIT next to reference, which follows with stepInstruction. PC and registers are
+    // compared after every translated block or interpreted instruction, memory at the end.
+    // Returns false on the first divergence.
+    bool executeDifferential(MIPSprocessor& reference) {
+        if (!JitCompiler::available()) {
+            std::cerr << "Error: JIT not available on this host" << std::endl;
+            return false;
+        }
+        const Tracer<TraceLevel::Summary> trace(traceLevel);
+        const Tracer<TraceLevel::Off> quiet(TraceLevel::Off);
+        JitContext context = startJit();
+        reference.running = true;
+        reference.PC = 0x0100;
 
-            // Check if writeMem is 1 (sw case)
-            if (WriteMem.test(0)) {
-                int16_t offset = instruction & 0xFFFF;  // Extract the offset (sign-extended)
-                if (offset & 0x8000) {                  // Handle sign-extension
-                    offset |= 0xFFFF0000;
+        while (running) {
+            if (PC > instructionSize) {
+                running = false;
+                break;
+            }
+            uint32_t blockPC = PC;
+            uint32_t executed = runJitStep(context, trace);
+            instructionCount += executed;
+            for (uint32_t i = 0; i < executed; i++) reference.stepInstruction(quiet);
+
+            if (reference.PC != PC || std::memcmp(reference.registers, registers, sizeof(registers)) != 0) {
+                std::cerr << "Differential mismatch after " << instructionCount << " instructions (block at " << blockPC << ")" << std::endl;
+                std::cerr << "PC: jit " << PC << ", interpreter " << reference.PC << std::endl;
+                for (int i = 0; i < 32; i++) {
+                    if (registers[i] != reference.registers[i]) {
+                        std::cerr << numberToReg(i) << ": jit " << registers[i] << ", interpreter " << reference.registers[i] << std::endl;
+                    }
                 }
-                uint32_t address = readRegister1 + offset;  // Final memory address
-                uint32_t value = registers[rt];             // The value from register[rt]
-
-                // Print initial memory values
-                std::cout << "Initial Memory Value:" << std::endl;
-                printWord(address, memoryAdd);
-
-                // Break the 32-bit value into 4 bytes and store them into the memory array
-                std::cout << "Data Cache:" << std::endl;
-                dataCache.put(address, value);        // Update cache
-                memoryAdd[address] = (value) & 0xFF;  // Store the most significant byte
-                memoryAdd[address + 1] = (value >> 8) & 0xFF;
-                memoryAdd[address + 2] = (value >> 16) & 0xFF;
-                memoryAdd[address + 3] = (value >> 24) & 0xFF;  // Store the least significant byte
-
-                // Print Final memory values
-                std::cout << "Final Memory Value:" << std::endl;
-                printWord(address, memoryAdd);
-
-                PC += 4;
-                continue;
+                return false;
             }
+        }
 
-            // If ReadMem is set, read from memory
-            uint32_t memData = 0;
-            if (ReadMem.test(0)) {
-                // Extract the immediate value from the instruction
-                uint32_t immediate = instruction & 0xFFFF;
+        uint32_t address;
+        if (memory.firstDifference(reference.memory, address)) {
+            std::cerr << "Differential mismatch: memory at " << address << ": jit " << +memory.readByte(address)
+                      << ", interpreter " << +reference.memory.readByte(address) << std::endl;
+            return false;
+        }
+        if (trace.enabled(TraceLevel::Summary)) {
+            std::cout << "Differential check passed: " << instructionCount << " instructions, " << jit.compiledBlocks() << " blocks compiled" << std::endl;
+        }
+        return true;
+    }
 
-                // Sign-extend the immediate to 32 bits
-                uint32_t signExtendedAddress = (immediate & 0x8000) ? (immediate | 0xFFFF0000) : immediate;
+    JitContext startJit() {
+        blockCache.reset(instructionSize);
+        jit.reset();
+        instructionCount = 0;
+        running = true;
+        PC = 0x0100;  // Start at address 0x0100
 
-                // Calculate the final address by adding to the base address (usually in rs)
-                uint32_t baseAddress = registers[rs];  // Assuming rs is defined somewhere
-                uint32_t address = baseAddress + signExtendedAddress;
+        JitContext context{};
+        context.registers = registers;
+        context.owner = this;
+        context.load = [](JitContext* context, uint32_t address) {
+            return static_cast<MIPSprocessor*>(context->owner)->loadWord(address);
+        };
+        context.store = [](JitContext* context, uint32_t address, uint32_t value) -> uint32_t {
+            return static_cast<MIPSprocessor*>(context->owner)->storeWord(address, value);
+        };
+        return context;
+    }
 
-                // Read memory using the calculated address
-                memData = readMemory(address);
+    // Runs the translated block at PC, or interprets one instruction when there is none.
+    // Returns the number of guest instructions executed.
+    template <typename TracerType>
+    uint32_t runJitStep(JitContext& context, const TracerType& trace) {
+        JitCompiler::Code code = jit.lookup(PC, blockCache);
+        if (code != nullptr) {
+            PC = code(&context);
+            return context.executed;
+        }
+        stepInstruction(trace);
+        return 1;
+    }
 
-                std::cout << "Memory Data: " << std::bitset<32>(memData) << std::endl;
+    // Executes the instruction at PC without the cache model or per-instruction trace
+    template <typename TracerType>
+    void stepInstruction(const TracerType& trace) {
+        const DecodedInstruction& decoded = decodedAt(PC);
+        switch (decoded.op) {
+            case Op::Add:
+                registers[decoded.rd] = registers[decoded.rs] + registers[decoded.rt];
+                PC += 4;
+                break;
+            case Op::Sub:
+                registers[decoded.rd] = registers[decoded.rs] - registers[decoded.rt];
+                PC += 4;
+                break;
+            case Op::And:
+                registers[decoded.rd] = registers[decoded.rs] & registers[decoded.rt];
+                PC += 4;
+                break;
+            case Op::Or:
+                registers[decoded.rd] = registers[decoded.rs] | registers[decoded.rt];
+                PC += 4;
+                break;
+            case Op::Slt:
+                registers[decoded.rd] = (int32_t)registers[decoded.rs] < (int32_t)registers[decoded.rt] ? 1 : 0;
+                PC += 4;
+                break;
+            case Op::Mult:
+            case Op::Div:
+            case Op::Mfhi:
+            case Op::Mflo:
+            case Op::UnknownR:
+                std::cerr << "Unknown R-type ALU operation" << std::endl;
+                registers[decoded.rd] = 0;
+                PC += 4;
+                break;
+            case Op::Addi:
+                registers[decoded.rd] = registers[decoded.rs] + decoded.imm;
+                PC += 4;
+                break;
+            case Op::Lw:
+                registers[decoded.rd] = loadWord(registers[decoded.rs] + decoded.imm);
+                PC += 4;
+                break;
+            case Op::Sw: {
+                uint32_t address = registers[decoded.rs] + decoded.imm;
+                uint32_t value = registers[decoded.rt];
+                PC += 4;  // decoded may be re-decoded by the store
+                storeWord(address, value);
+                break;
             }
+            case Op::Beq:
+                PC = registers[decoded.rs] == registers[decoded.rt] ? decoded.imm : PC + 4;
+                break;
+            case Op::J:
+                PC = decoded.imm;
+                break;
+            case Op::Jal:
+                registers[31] = PC + 4;
+                PC = decoded.imm;
+                break;
+            case Op::Jr:
+                PC = registers[31];  // jr always returns through $ra
+                break;
+            case Op::Syscall:
+                PC += 4;
+                executeSyscall(trace);
+                break;
+            case Op::Nop:
+                PC += 4;
+                break;
+        }
+    }
 
-            // If WriteReg is set, write the result to the rd register
-            if (WriteReg.test(0) && !(Jump.test(0))) {
-                std::cout << "Initial Register Values:" << std::endl;
-
-                if (MemtoReg.test(0)) {
-                    std::cout << numberToReg(rs) << ": " << std::bitset<32>(registers[rs]) << " ( " << registers[rs] << " )" << std::endl;
-                    std::cout << numberToReg(rd) << ": " << std::bitset<32>(registers[rd]) << " ( " << registers[rd] << " )" << std::endl;
-
-                    registers[rd] = memData;
+    // Writes an R-type or addi result to rd, tracing rs, rt and rd around the write
+    template <typename TracerType>
+    void writeRegister(const TracerType& trace, const DecodedInstruction& decoded, uint32_t value) {
+        if (trace.enabled(TraceLevel::Instruction)) {
+            std::cout << "Initial Register Values:" << std::endl;
+            printRegisterValue(decoded.rs);
+            printRegisterValue(decoded.rt);
+            printRegisterValue(decoded.rd);
+        }
+        registers[decoded.rd] = value;
+        if (trace.enabled(TraceLevel::Instruction)) {
+            std::cout << "Final Register Values:" << std::endl;
+            printRegisterValue(decoded.rs);
+            printRegisterValue(decoded.rt);
+            printRegisterValue(decoded.rd);
+        }
+    }
 
-                    std::cout << "Final Register Values:" << std::endl;
-                    std::cout << numberToReg(rs) << ": " << std::bitset<32>(registers[rs]) << " ( " << registers[rs] << " )" << std::endl;
-                    std::cout << numberToReg(rd) << ": " << std::bitset<32>(registers[rd]) << " ( " << registers[rd] << " )" << std::endl;
-                } else {
-                    std::cout << numberToReg(rs) << ": " << std::bitset<32>(registers[rs]) << " ( " << registers[rs] << " )" << std::endl;
-                    std::cout << numberToReg(rt) << ": " << std::bitset<32>(registers[rt]) << " ( " << registers[rt] << " )" << std::endl;
-                    std::cout << numberToReg(rd) << ": " << std::bitset<32>(registers[rd]) << " ( " << registers[rd] << " )" << std::endl;
+    template <typename TracerType>
+    void executeSyscall(const TracerType& trace) {
+        uint32_t v0 = registers[2];  // get syscall code in $v0
+        switch (v0) {
+            case 1:  // print integer
+                if (syscallOutput) std::cout << "Syscall print integer: " << registers[4] << std::endl;  // $a0 = reg 4
+                break;
+            case 10:  // exit
+                if (trace.enabled(TraceLevel::Summary)) std::cout << "Syscall exit called. Terminating program." << std::endl;
+                running = false;
+                break;
+            // add more syscalls as needed
+            default:
+                std::cerr << "Unknown syscall code: " << v0 << std::endl;
+                running = false;
+                break;
+        }
+    }
 
-                    registers[rd] = ALUResult;
+    // Reads a data word (stored least significant byte first)
+    uint32_t loadWord(uint32_t address) {
+        return memory.readWord(address);
+    }
 
-                    std::cout << "Final Register Values:" << std::endl;
-                    std::cout << numberToReg(rs) << ": " << std::bitset<32>(registers[rs]) << " ( " << registers[rs] << " )" << std::endl;
-                    std::cout << numberToReg(rt) << ": " << std::bitset<32>(registers[rt]) << " ( " << registers[rt] << " )" << std::endl;
-                    std::cout << numberToReg(rd) << ": " << std::bitset<32>(registers[rd]) << " ( " << registers[rd] << " )" << std::endl;
-                }
-            }
+    // Stores a word least significant byte first. Returns true when the store hit a code page,
+    // after invalidating everything derived from the words it overlaps.
+    bool storeWord(uint32_t address, uint32_t value) {
+        memory.writeWord(address, value);
+        if (!codePages.contains(address) && !codePages.contains(address + 3)) return false;  // Pure data page
+        invalidateCode(address);
+        return true;
+    }
 
-            // Branch and jump logic
-            if (Branch.test(0) && ALUResult == 0) {
-                PC += (instruction & 0xFFFF) << 2;
-            } else if (Jump.test(0)) {
-                // j case
-                PC += 4;
-                if (WriteReg.test(0)) {
-                    // jal case
-                    std::cout << "Initial Register Values:" << std::endl;
-                    std::cout << numberToReg(31) << ": " << std::bitset<32>(registers[31]) << " ( " << registers[31] << " )" << std::endl;
-                    registers[31] = PC;
-                    std::cout << "Final Register Values:" << std::endl;
-                    std::cout << numberToReg(31) << ": " << std::bitset<32>(registers[31]) << " ( " << registers[31] << " )" << std::endl;
-                }
-                uint32_t address = (instruction & 0x03FFFFFF) << 2;
-                PC = (PC & 0xF0000000) | address;
-                if (RegDst.test(0)) {
-                    // jr case
-                    PC = registers[31];
-                }
-                if (WriteReg.test(0)) {
-                    // set PC for jal
-                    PC = (instruction & 0x03FFFFFF) << 2;
-                }
-            } else {
-                PC += 4;
+    // Brings the instruction cache, decoded words, blocks and host code in line with a store
+    // of the word at address
+    void invalidateCode(uint32_t address) {
+        if (address + 3 >= 0x0100 && address <= instructionSize + 3) {
+            uint32_t first = std::max<uint32_t>(address & ~3u, 0x0100);
+            uint32_t last = std::min<uint32_t>((address + 3) & ~3u, instructionSize);
+            for (uint32_t word = first; word <= last; word += 4) {
+                decodedInstructions[(word - 0x0100) >> 2] = decodeWord(fetchWord(word), word);
             }
-
-            // Handle syscall
-            if (opcode == 0 && funct == 0x0C) {  // syscall detected
-                uint32_t v0 = registers[2];      // get syscall code in $v0
-                switch (v0) {
-                    case 1:                                                                   // print integer
-                        std::cout << "Syscall print integer: " << registers[4] << std::endl;  // $a0 = reg 4
-                        break;
-                    case 10:  // exit
-                        std::cout << "Syscall exit called. Terminating program." << std::endl;
-                        running = false;
-                        break;
-                    // add more syscalls as needed
-                    default:
-                        std::cerr << "Unknown syscall code: " << v0 << std::endl;
-                        running = false;
-                        break;
-                }
-            }
-
-            std::cout << "Final PC: " << PC << std::endl;
         }
+        instructionCache.invalidate(address);
+        instructionCache.invalidate(address + 3);  // The store may straddle two lines
+        blockCache.invalidate(address, 4);
+        jit.invalidate(address, 4);
     }
 
     void setControlSignal(uint8_t opcode, uint8_t funct) {
@@ -1264,27 +1417,40 @@ class MIPSprocessor  // Class for the processor
         if (jr || syscall) {
             WriteReg = 0;  // Disable WriteReg for jr and syscall
         }
+    }
+
+    // Packs the current control signals into ControlFlag bits
+    uint16_t packControlSignals() const {
+        return (RegDst.test(0) ? kRegDst : 0) | (Branch.test(0) ? kBranch : 0) | (ReadMem.test(0) ? kReadMem : 0) |
+               (MemtoReg.test(0) ? kMemtoReg : 0) | (WriteMem.test(0) ? kWriteMem : 0) | (ALUSrc.test(0) ? kALUSrc : 0) |
+               (WriteReg.test(0) ? kWriteReg : 0) | (ALUOp0.test(0) ? kALUOp0 : 0) | (ALUOp1.test(0) ? kALUOp1 : 0) |
+               (Jump.test(0) ? kJump : 0);
+    }
 
-        // Print control signals for debugging
-        std::cout << "RegDst: " << RegDst << "\n";
-        std::cout << "WriteReg: " << WriteReg << "\n";
-        std::cout << "ALUSrc: " << ALUSrc << "\n";
-        std::cout << "MemtoReg: " << MemtoReg << "\n";
-        std::cout << "WriteMem: " << WriteMem << "\n";
-        std::cout << "ReadMem: " << ReadMem << "\n";
-        std::cout << "Branch: " << Branch << "\n";
-        std::cout << "ALUOp: " << ALUOp1 << ALUOp0 << "\n";
-        std::cout << "Jump: " << Jump << "\n";
+    // Print control signals for debugging
+    void printControlSignals(uint16_t signals) {
+        std::cout << "RegDst: " << ((signals & kRegDst) != 0) << "\n";
+        std::cout << "WriteReg: " << ((signals & kWriteReg) != 0) << "\n";
+        std::cout << "ALUSrc: " << ((signals & kALUSrc) != 0) << "\n";
+        std::cout << "MemtoReg: " << ((signals & kMemtoReg) != 0) << "\n";
+        std::cout << "WriteMem: " << ((signals & kWriteMem) != 0) << "\n";
+        std::cout << "ReadMem: " << ((signals & kReadMem) != 0) << "\n";
+        std::cout << "Branch: " << ((signals & kBranch) != 0) << "\n";
+        std::cout << "ALUOp: " << ((signals & kALUOp1) != 0) << ((signals & kALUOp0) != 0) << "\n";
+        std::cout << "Jump: " << ((signals & kJump) != 0) << "\n";
     }
 
-    uint32_t ALUOperation(uint32_t readRegister1, uint32_t readRegister2, uint8_t funct) {
-        if (ALUOp1 == 0 && ALUOp0 == 0) {
+    // Datapath ALU result for the given control signals, used by the signal trace
+    uint32_t ALUOperation(uint16_t signals, uint32_t readRegister1, uint32_t readRegister2, uint8_t funct) {
+        bool ALUOp1 = signals & kALUOp1;
+        bool ALUOp0 = signals & kALUOp0;
+        if (!ALUOp1 && !ALUOp0) {
             // ADD operation (used for add, addi, lw, sw)
             return readRegister1 + readRegister2;
-        } else if (ALUOp1 == 0 && ALUOp0 == 1) {
+        } else if (!ALUOp1 && ALUOp0) {
             // SUB operation (used for sub, beq)
             return readRegister1 - readRegister2;
-        } else if (ALUOp1 == 1 && ALUOp0 == 0) {
+        } else if (ALUOp1 && !ALUOp0) {
             // R-type operations determined by funct
             switch (funct) {
                 case 0x20:  // ADD
@@ -1297,31 +1463,108 @@ class MIPSprocessor  // Class for the processor
                     return readRegister1 | readRegister2;
                 case 0x2A:  // SLT (Set on Less Than)
                     return (int32_t)readRegister1 < (int32_t)readRegister2 ? 1 : 0;
-                case 0x08:  // jr case
-                    return 0;
-                case 0x0C:     // syscall
-                    return 0;  // No ALU operation for syscall
-                default:
-                    std::cerr << "Unknown R-type ALU operation" << std::endl;
+                default:  // jr, syscall and unsupported operations
                     return 0;
             }
         } else {
-            std::cerr << "Unknown ALUOp combination" << std::endl;
             return 0;
         }
     }
 
     uint32_t readMemory(uint32_t address) {
-        std::cout << "Data Cache:" << std::endl;
-        uint32_t data = dataCache.get(address);
-        if (data == UINT32_MAX) {  // Cache miss
-            data = (static_cast<uint32_t>(memoryAdd[address])) |
-                   (static_cast<uint32_t>(memoryAdd[address + 1]) << 8) |
-                   (static_cast<uint32_t>(memoryAdd[address + 2]) << 16) |
-                   (static_cast<uint32_t>(memoryAdd[address + 3]) << 24);
-            dataCache.put(address, data);
+        // The cache model only tracks tags; the word comes from memory
+        accessData(address, false);
+        return loadWord(address);
+    }
+
+    // Runs a load or store through the data cache and charges its stall to the timing models
+    void accessData(uint32_t address, bool write) {
+        uint32_t stall = hierarchy.access(dataCache, address, write) - 1;
+        dataStallCycles += stall;
+        if (pipelined) pipeline.addMemoryStall(stall);
+        if (outOfOrder) outOfOrderCore.addMemoryStall(stall);
+        if (collectingStats) workloadStats.access(address, write);
+    }
+
+    // Cycle estimate of the last interpreter run (one cycle per instruction plus memory stalls),
+    // the pipeline and out-of-order models and the branch predictors when enabled, the counters
+    // of every cache and the traffic between the caches and memory
+    void printTiming() {
+        uint64_t cycles = instructionCount + fetchStallCycles + dataStallCycles;
+        std::cout << "Cycles: " << cycles << " (fetch stalls " << fetchStallCycles << ", data stalls " << dataStallCycles
+                  << "), CPI " << (instructionCount > 0 ? double(cycles) / instructionCount : 0) << std::endl;
+        if (pipelined) {
+            uint64_t pipelineCycles = pipeline.cycles();
+            std::cout << "Pipeline: " << pipelineCycles << " cycles, CPI "
+                      << (pipeline.instructions() > 0 ? double(pipelineCycles) / pipeline.instructions() : 0)
+                      << " (forwarding " << (pipeline.forwarding() ? "on" : "off") << "); stall cycles:";
+            for (size_t cause = 0; cause < static_cast<size_t>(StallCause::Count); cause++) {
+                std::cout << (cause > 0 ? ", " : " ") << stallCauseName(static_cast<StallCause>(cause)) << " "
+                          << pipeline.stallCycles(static_cast<StallCause>(cause));
+            }
+            std::cout << std::endl;
+        }
+        if (outOfOrder) {
+            const OutOfOrderConfig& core = outOfOrderCore.configuration();
+            uint64_t coreCycles = outOfOrderCore.cycles();
+            std::cout << "Out-of-order: " << coreCycles << " cycles, IPC "
+                      << (coreCycles > 0 ? double(outOfOrderCore.instructions()) / coreCycles : 0) << " (width " << core.width
+                      << ", ROB " << core.robSize << ", " << core.stations << " stations); stall cycles:";
+            for (size_t stall = 0; stall < static_cast<size_t>(OutOfOrderStall::Count); stall++) {
+                std::cout << (stall > 0 ? ", " : " ") << outOfOrderStallName(static_cast<OutOfOrderStall>(stall)) << " "
+                          << outOfOrderCore.stallCycles(static_cast<OutOfOrderStall>(stall));
+            }
+            std::cout << std::endl;
+        }
+        if (predicting) branchUnit.printStats(instructionCount);
+        printCacheStats("Instruction cache", instructionCache);
+        printCacheStats("Data cache", dataCache);
+        const std::vector<CacheModel>& levels = hierarchy.lowerLevels();
+        for (size_t level = 0; level < levels.size(); level++) printCacheStats("L" + std::to_string(level + 2) + " cache", levels[level]);
+        const MemoryTraffic& traffic = hierarchy.traffic();
+        std::cout << "Memory traffic: " << traffic.readTransactions << " reads (" << traffic.readBytes << " bytes), "
+                  << traffic.writeTransactions << " writes (" << traffic.writeBytes << " bytes), " << traffic.writebacks
+                  << " write-backs" << std::endl;
+    }
+
+    // Hot spots of the last interpreter run with their label and source line, then the call
+    // graph and the folded call stacks. The folded stacks go to foldedPath, or to stdout when
+    // it is empty.
+    void printProfile(const std::string& foldedPath) {
+        static constexpr size_t kHotSpots = 20;
+        std::vector<std::string_view> lineText;  // Source text by line; empty for a cached image
+        for (const SourceInstruction& instruction : instructions) {
+            if (instruction.line >= lineText.size()) lineText.resize(instruction.line + 1);
+            lineText[instruction.line] = instruction.text;
         }
-        return data;
+
+        uint64_t total = profiler.instructions();
+        std::cout << "Profile: " << total << " instructions (" << profiler.instructionsOutsideText() << " outside .text)" << std::endl;
+        std::cout << "Hot spots:" << std::endl;
+        for (const HotSpot& spot : profiler.hotSpots(kHotSpots)) {
+            uint32_t offset;
+            const std::string& function = profiler.functionAt(spot.pc, offset);
+            uint32_t line = sourceLineAt(spot.pc);
+            std::cout << std::setfill(' ') << std::setw(12) << spot.count << std::fixed << std::setprecision(2) << std::setw(8)
+                      << (total > 0 ? 100.0 * spot.count / total : 0) << "%  0x" << std::hex << std::setw(8)
+                      << std::setfill('0') << spot.pc << std::dec << std::setfill(' ') << std::defaultfloat << "  "
+                      << function << "+" << offset << "  line " << line;
+            if (line < lineText.size()) std::cout << ": " << lineText[line];
+            std::cout << std::endl;
+        }
+        std::cout << "Call graph:" << std::endl;
+        profiler.printCallGraph(std::cout);
+        if (foldedPath.empty()) {
+            std::cout << "Folded stacks:" << std::endl;
+            profiler.printFoldedStacks(std::cout);
+            return;
+        }
+        std::ofstream file(foldedPath);
+        if (!file) {
+            std::cerr << "Error: Cannot write profile: " << foldedPath << std::endl;
+            return;
+        }
+        profiler.printFoldedStacks(file);
     }
 
     // function the print the part of memory where data is stored
@@ -1332,19 +1575,7 @@ class MIPSprocessor  // Class for the processor
             std::cout << "0x" << std::hex << std::setw(8) << std::setfill('0') << i << ":\t\t";
 
             // Combine 4 bytes into a 32-bit word (little-endian)
-            uint32_t word = 0;
-            if (i < sizeof(memoryAdd)) {
-                word |= memoryAdd[i];
-            }
-            if (i + 1 < sizeof(memoryAdd)) {
-                word |= (memoryAdd[i + 1] << 8);
-            }
-            if (i + 2 < sizeof(memoryAdd)) {
-                word |= (memoryAdd[i + 2] << 16);
-            }
-            if (i + 3 < sizeof(memoryAdd)) {
-                word |= (memoryAdd[i + 3] << 24);
-            }
+            uint32_t word = memory.readWord(static_cast<uint32_t>(i));
 
             // Print the word as hexadecimal and binary
             std::cout << "0x" << std::hex << std::setw(8) << std::setfill('0') << word << "\t\t";
@@ -1353,17 +1584,19 @@ class MIPSprocessor  // Class for the processor
     }
 
     // Function to print word
-    void printWord(uint32_t address, uint8_t* memoryAdd) {
+    void printWord(uint32_t address) {
         // Combine the 4 bytes into a single 32-bit integer
-        uint32_t value = (memoryAdd[address]) |
-                         (memoryAdd[address + 1] << 8) |
-                         (memoryAdd[address + 2] << 16) |
-                         (memoryAdd[address + 3] << 24);
+        uint32_t value = memory.readWord(address);
 
         // Print the binary representation (32 bits) and its decimal value
         std::cout << "Address: " << std::bitset<32>(address) << " ( " << address << " ), Value: " << std::bitset<32>(value) << " ( " << value << " )" << std::endl;
     }
 
+    // Prints one register as "name: binary ( decimal )"
+    void printRegisterValue(uint8_t reg) {
+        std::cout << numberToReg(reg) << ": " << std::bitset<32>(registers[reg]) << " ( " << registers[reg] << " )" << std::endl;
+    }
+
     // Print Register Values
     void printRegister() {
         std::cout << "\nRegister Values:\nRegister\t\tValue (Hex)\t\tValue (Decimal)\n";
@@ -1378,11 +1611,13 @@ class MIPSprocessor  // Class for the processor
 
    public:
     MIPSprocessor()
-        : instructionCache(12), dataCache(12) {
+        : instructionCache(kDefaultCacheConfig), dataCache(kDefaultCacheConfig),
+          hierarchy(kDefaultHierarchyConfig),
+          blockCache([this](uint32_t address) { return decodedAt(address); }) {
         symbolTable.clear();
         instructions.clear();
         funcMap.clear();
-        std::fill(std::begin(memoryAdd), std::end(memoryAdd), 0);
+        labelStarts.clear();
 
         // Initialize the registers to 0
         for (int i = 0; i < 32; i++) {
@@ -1396,20 +1631,162 @@ class MIPSprocessor  // Class for the processor
         currentDataAddress = dataMemoryStart;
         PC = 0x0100;
         instructionSize = 0;
+        textEnd = 0x0100;
+        traceLevel = TraceLevel::Signal;
+        engine = Engine::Interpreter;
+        instructionCount = 0;
+        fetchStallCycles = 0;
+        dataStallCycles = 0;
+        pipelined = false;
+        outOfOrder = false;
+        profiling = false;
+        collectingStats = false;
+        predicting = false;
+        syscallOutput = true;
     }
 
     ~MIPSprocessor() {}
 };
 
-int main() {
+int main(int argc, char* argv[]) {
     MIPSprocessor Processor;
+    std::string sourceFile = "test_code_1_mips_sim.asm";
+    bool useImageCache = false;
+    std::string foldedStacksPath;  // Profile folded stacks go to stdout when empty
+    std::string statsPath;         // Workload statistics go to stdout when empty
+    HierarchyConfig hierarchyConfig = kDefaultHierarchyConfig;
+
+    // Usage: MIPS_sim [--trace=off|summary|instruction|signal] [--engine=interpreter|threaded|block|jit|diff] [--image-cache]
+    //                 [--icache=GEOMETRY] [--dcache=GEOMETRY] [--l2=GEOMETRY] [--l3=GEOMETRY] [--latency=l1:l2:l3:memory]
+    //                 [--pipeline[=forward|noforward]] [--predictor[=KIND[:tableBits[:historyBits[:btbEntries[:rasDepth]]]]]]
+    //                 [--ooo[=width:rob:stations[:alu:multiply:divide]]] [--profile[=folded.txt]]
+    //                 [--stats[=stats.json]] [file.asm]
+    // KIND is nottaken|bimodal|gshare|tournament; every kind is measured, the pipeline follows KIND
+    // GEOMETRY is size:line:ways[:lfu|lru|clock|random|arc|plru[:wb|wt[:wa|nwa]]]
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--trace=", 0) == 0) {
+            if (!parseTraceLevel(arg.substr(8), Processor.traceLevel)) {
+                std::cerr << "Error: Unknown trace level: " << arg.substr(8) << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--image-cache") {
+            useImageCache = true;
+        } else if (arg.rfind("--icache=", 0) == 0 || arg.rfind("--dcache=", 0) == 0) {
+            CacheConfig config = (arg[2] == 'i' ? Processor.instructionCache : Processor.dataCache).geometry();
+            if (!parseCacheConfig(arg.substr(9), config)) {
+                std::cerr << "Error: Invalid cache geometry: " << arg.substr(9) << std::endl;
+                return EXIT_FAILURE;
+            }
+            (arg[2] == 'i' ? Processor.instructionCache : Processor.dataCache) = CacheModel(config);
+        } else if (arg.rfind("--l2=", 0) == 0 || arg.rfind("--l3=", 0) == 0) {
+            bool l2 = arg[3] == '2';
+            if (!parseCacheConfig(arg.substr(5), l2 ? hierarchyConfig.l2 : hierarchyConfig.l3)) {
+                std::cerr << "Error: Invalid cache geometry: " << arg.substr(5) << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!l2) hierarchyConfig.hasL3 = true;
+        } else if (arg.rfind("--latency=", 0) == 0) {
+            if (!parseLatencies(arg.substr(10), hierarchyConfig)) {
+                std::cerr << "Error: Invalid latencies: " << arg.substr(10) << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--pipeline" || arg == "--pipeline=forward" || arg == "--pipeline=noforward") {
+            Processor.pipelined = true;
+            Processor.pipeline = PipelineModel(arg != "--pipeline=noforward");
+        } else if (arg == "--profile" || arg.rfind("--profile=", 0) == 0) {
+            Processor.profiling = true;
+            if (arg != "--profile") foldedStacksPath = arg.substr(10);
+        } else if (arg == "--stats" || arg.rfind("--stats=", 0) == 0) {
+            Processor.collectingStats = true;
+            if (arg != "--stats") statsPath = arg.substr(8);
+        } else if (arg == "--ooo" || arg.rfind("--ooo=", 0) == 0) {
+            OutOfOrderConfig config = kDefaultOutOfOrderConfig;
+            if (arg != "--ooo" && !parseOutOfOrderConfig(arg.substr(6), config)) {
+                std::cerr << "Error: Invalid out-of-order core: " << arg.substr(6) << std::endl;
+                return EXIT_FAILURE;
+            }
+            Processor.outOfOrder = true;
+            Processor.outOfOrderCore = OutOfOrderModel(config);
+        } else if (arg == "--predictor" || arg.rfind("--predictor=", 0) == 0) {
+            PredictorConfig config = kDefaultPredictorConfig;
+            if (arg != "--predictor" && !parsePredictorConfig(arg.substr(12), config)) {
+                std::cerr << "Error: Invalid branch predictor: " << arg.substr(12) << std::endl;
+                return EXIT_FAILURE;
+            }
+            Processor.predicting = true;
+            Processor.branchUnit = BranchPredictionUnit(config);
+        } else if (arg.rfind("--engine=", 0) == 0) {
+            std::string name = arg.substr(9);
+            if (name == "interpreter") {
+                Processor.engine = Engine::Interpreter;
+            } else if (name == "threaded") {
+                Processor.engine = Engine::Threaded;
+            } else if (name == "block") {
+                Processor.engine = Engine::Block;
+            } else if (name == "jit") {
+                Processor.engine = Engine::Jit;
+            } else if (name == "diff") {
+                Processor.engine = Engine::Differential;
+            } else {
+                std::cerr << "Error: Unknown engine: " << name << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else {
+            sourceFile = arg;
+        }
+    }
+
+    // The timing models, profiler and statistics hook into the interpreter loop only
+    bool analyzing = Processor.pipelined || Processor.predicting || Processor.outOfOrder || Processor.profiling ||
+                     Processor.collectingStats;
+    if (analyzing && Processor.engine != Engine::Interpreter) {
+        std::cerr << "Error: --pipeline, --predictor, --ooo, --profile and --stats need --engine=interpreter" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Processor.hierarchy = MemoryHierarchy(hierarchyConfig);
+    Processor.loadProgram(sourceFile, useImageCache);
 
-    Processor.readFile("test_code_1_mips_sim.asm");
-    Processor.assembleInstructions();
-    Processor.executeInstructions();
+    // The differential engine needs a second processor as its reference
+    MIPSprocessor* Reference = nullptr;
+    if (Processor.engine == Engine::Differential) {
+        Reference = new MIPSprocessor();
+        Reference->traceLevel = TraceLevel::Off;
+        Reference->syscallOutput = false;
+        Reference->loadProgram(sourceFile, useImageCache);
+    }
 
-    Processor.printMemory();
-    Processor.printRegister();
+    bool passed = true;
+    auto start = std::chrono::steady_clock::now();
+    if (Reference != nullptr) {
+        passed = Processor.executeDifferential(*Reference);
+        delete Reference;
+    } else {
+        Processor.executeInstructions();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (Processor.traceLevel >= TraceLevel::Summary) {
+        std::cout << "Executed " << Processor.instructionCount << " instructions in " << elapsed.count() << " s ("
+                  << (elapsed.count() > 0 ? Processor.instructionCount / elapsed.count() : 0) << " instructions/s)" << std::endl;
+        if (Processor.engine == Engine::Interpreter) Processor.printTiming();  // Only the interpreter models the caches
+        Processor.printMemory();
+        Processor.printRegister();
+    }
+    if (Processor.profiling) Processor.printProfile(foldedStacksPath);
+    if (Processor.collectingStats) {
+        if (statsPath.empty()) {
+            Processor.workloadStats.writeJson(std::cout);
+        } else {
+            std::ofstream file(statsPath);
+            if (!file) {
+                std::cerr << "Error: Cannot write statistics: " << statsPath << std::endl;
+                return EXIT_FAILURE;
+            }
+            Processor.workloadStats.writeJson(file);
+        }
+    }
 
-    return EXIT_SUCCESS;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
 }
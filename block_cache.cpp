@@ -0,0 +1,85 @@
+#include "block_cache.h"
+
+BlockCache::BlockCache(std::function<DecodedInstruction(uint32_t)> decoder)
+    : decoder(std::move(decoder)), lastAddress(0), translated(0), invalidated(0) {}
+
+void BlockCache::reset(uint32_t last) {
+    blocks.clear();
+    lastAddress = last;
+    translated = 0;
+    invalidated = 0;
+}
+
+TranslatedBlock* BlockCache::translate(uint32_t pc) {
+    auto block = std::make_unique<TranslatedBlock>();
+    block->startPC = pc;
+    block->instructionCount = 0;
+    block->successors[0] = nullptr;
+    block->successors[1] = nullptr;
+
+    for (uint32_t address = pc;; address += 4) {
+        DecodedInstruction decoded = decoder(address);
+        BlockOp op{BlockOpKind::Fallthrough, decoded.rs, decoded.rt, decoded.rd, decoded.imm, address};
+        block->instructionCount++;
+        block->endPC = address;
+
+        switch (decoded.op) {
+            case Op::Add: op.kind = BlockOpKind::Add; break;
+            case Op::Sub: op.kind = BlockOpKind::Sub; break;
+            case Op::And: op.kind = BlockOpKind::And; break;
+            case Op::Or: op.kind = BlockOpKind::Or; break;
+            case Op::Slt: op.kind = BlockOpKind::Slt; break;
+            case Op::Mult:
+            case Op::Div:
+            case Op::Mfhi:
+            case Op::Mflo:
+            case Op::UnknownR: op.kind = BlockOpKind::ClearReg; break;
+            case Op::Addi: op.kind = BlockOpKind::AddImm; break;
+            case Op::Lw: op.kind = BlockOpKind::Load; break;
+            case Op::Sw: op.kind = BlockOpKind::Store; break;
+            case Op::Beq: op.kind = BlockOpKind::Beq; break;
+            case Op::J: op.kind = BlockOpKind::J; break;
+            case Op::Jal: op.kind = BlockOpKind::Jal; break;
+            case Op::Jr: op.kind = BlockOpKind::Jr; break;
+            case Op::Syscall: op.kind = BlockOpKind::Syscall; break;
+            case Op::Nop: break;  // Counted but not emitted
+        }
+
+        if (decoded.op != Op::Nop) {
+            block->ops.push_back(op);
+            if (isTerminator(op.kind)) break;
+        }
+        if (address >= lastAddress || block->instructionCount == kMaxBlockInstructions) {
+            // Continue at the next address through a fall-through exit
+            block->ops.push_back(BlockOp{BlockOpKind::Fallthrough, 0, 0, 0, address + 4, address});
+            break;
+        }
+    }
+
+    translated++;
+    TranslatedBlock* result = block.get();
+    blocks[pc] = std::move(block);
+    return result;
+}
+
+bool BlockCache::invalidate(uint32_t address, uint32_t size) {
+    bool dropped = false;
+    for (auto it = blocks.begin(); it != blocks.end();) {
+        const TranslatedBlock& block = *it->second;
+        if (address < block.endPC + 4 && block.startPC < address + size) {
+            it = blocks.erase(it);
+            invalidated++;
+            dropped = true;
+        } else {
+            ++it;
+        }
+    }
+    if (dropped) {
+        // Chains may point at dropped blocks; they are rebuilt on the next exits
+        for (auto& kv : blocks) {
+            kv.second->successors[0] = nullptr;
+            kv.second->successors[1] = nullptr;
+        }
+    }
+    return dropped;
+}
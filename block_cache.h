@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "decode.h"
+
+// Specialized operation of a translated block
+enum class BlockOpKind : uint8_t {
+    Add,
+    Sub,
+    And,
+    Or,
+    Slt,
+    AddImm,    // addi
+    ClearReg,  // Unsupported R-type: reports the error and writes 0 to rd
+    Load,
+    Store,
+    // Terminators, always the last operation of a block
+    Beq,
+    J,
+    Jal,
+    Jr,
+    Syscall,
+    Fallthrough,  // Block cut at the length limit or the end of the text segment
+};
+
+inline bool isTerminator(BlockOpKind kind) { return kind >= BlockOpKind::Beq; }
+
+struct BlockOp {
+    BlockOpKind kind;
+    uint8_t rs, rt, rd;
+    uint32_t imm;  // Immediate, load/store offset, or exit target
+    uint32_t pc;   // Guest address of the instruction
+};
+
+// Straight-line run of guest instructions ending at a control transfer
+struct TranslatedBlock {
+    uint32_t startPC;
+    uint32_t endPC;                  // Address of the last guest instruction
+    uint32_t instructionCount;       // Guest instructions covered, nops included
+    std::vector<BlockOp> ops;        // Body with nops removed, terminator last
+    TranslatedBlock* successors[2];  // Chained blocks for the taken (0) and fall-through (1) exits
+};
+
+// Translation cache of basic blocks keyed by start address
+class BlockCache {
+   public:
+    static constexpr uint32_t kMaxBlockInstructions = 64;
+
+    // decoder returns the decoded instruction at a guest address
+    explicit BlockCache(std::function<DecodedInstruction(uint32_t)> decoder);
+
+    // Drops every block; blocks never extend past lastAddress
+    void reset(uint32_t lastAddress);
+
+    // Returns the block starting at pc, translating it on a miss
+    TranslatedBlock* lookup(uint32_t pc) {
+        auto it = blocks.find(pc);
+        if (it != blocks.end()) return it->second.get();
+        return translate(pc);
+    }
+
+    // Drops every block overlapping [address, address + size) and unchains all blocks.
+    // Returns true if any block was dropped.
+    bool invalidate(uint32_t address, uint32_t size);
+
+    uint64_t translations() const { return translated; }
+    uint64_t invalidations() const { return invalidated; }
+
+   private:
+    TranslatedBlock* translate(uint32_t pc);
+
+    std::function<DecodedInstruction(uint32_t)> decoder;
+    std::unordered_map<uint32_t, std::unique_ptr<TranslatedBlock>> blocks;
+    uint32_t lastAddress;
+    uint64_t translated;
+    uint64_t invalidated;
+};
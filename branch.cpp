@@ -0,0 +1,146 @@
+#include "branch.h"
+
+#include <charconv>
+#include <iomanip>
+#include <iostream>
+
+const char* predictorName(PredictorKind kind) {
+    switch (kind) {
+        case PredictorKind::NotTaken:
+            return "nottaken";
+        case PredictorKind::Bimodal:
+            return "bimodal";
+        case PredictorKind::Gshare:
+            return "gshare";
+        case PredictorKind::Tournament:
+            return "tournament";
+        case PredictorKind::Count:
+            break;
+    }
+    return "unknown";
+}
+
+bool parsePredictorConfig(const std::string& text, PredictorConfig& config) {
+    PredictorConfig parsed = config;
+    size_t end = text.find(':');
+    std::string kind = text.substr(0, end);
+    bool known = false;
+    for (size_t candidate = 0; candidate < static_cast<size_t>(PredictorKind::Count); candidate++) {
+        if (kind != predictorName(static_cast<PredictorKind>(candidate))) continue;
+        parsed.kind = static_cast<PredictorKind>(candidate);
+        known = true;
+    }
+    if (!known) return false;
+
+    // The remaining fields are numbers in declaration order
+    for (uint32_t* field : {&parsed.tableBits, &parsed.historyBits, &parsed.btbEntries, &parsed.rasDepth}) {
+        if (end == std::string::npos) break;
+        const char* first = text.data() + end + 1;
+        end = text.find(':', end + 1);
+        const char* last = text.data() + (end == std::string::npos ? text.size() : end);
+        auto [stop, error] = std::from_chars(first, last, *field);
+        if (error != std::errc() || stop != last) return false;
+    }
+    if (end != std::string::npos) return false;  // Trailing fields
+
+    bool btbPowerOfTwo = parsed.btbEntries != 0 && (parsed.btbEntries & (parsed.btbEntries - 1)) == 0;
+    if (parsed.tableBits < 2 || parsed.tableBits > 24 || parsed.historyBits > parsed.tableBits || !btbPowerOfTwo) return false;
+    config = parsed;
+    return true;
+}
+
+DirectionPredictor::DirectionPredictor(PredictorKind kind, const PredictorConfig& config) : predictor(make(kind, config)) {}
+
+DirectionPredictor::Variant DirectionPredictor::make(PredictorKind kind, const PredictorConfig& config) {
+    switch (kind) {
+        case PredictorKind::Bimodal:
+            return BimodalPredictor(config);
+        case PredictorKind::Gshare:
+            return GsharePredictor(config);
+        case PredictorKind::Tournament:
+            return TournamentPredictor(config);
+        case PredictorKind::NotTaken:
+        case PredictorKind::Count:
+            break;
+    }
+    return NotTakenPredictor(config);
+}
+
+BranchPredictionUnit::BranchPredictionUnit(const PredictorConfig& predictorConfig)
+    : config(predictorConfig), targets(predictorConfig.btbEntries), returns(predictorConfig.rasDepth) {
+    reset();
+}
+
+void BranchPredictionUnit::reset() {
+    predictors.clear();
+    for (size_t kind = 0; kind < static_cast<size_t>(PredictorKind::Count); kind++) {
+        predictors.emplace_back(static_cast<PredictorKind>(kind), config);
+    }
+    stats.assign(predictors.size(), BranchStats{});
+    targets = BranchTargetBuffer(config.btbEntries);
+    returns = ReturnAddressStack(config.rasDepth);
+    jumps = 0;
+    jumpMisses = 0;
+    returnCount = 0;
+    returnMisses = 0;
+}
+
+bool BranchPredictionUnit::resolveTransfer(Op op, uint32_t pc, uint32_t nextPC) {
+    uint32_t fallThrough = pc + 4;
+    uint32_t target = fallThrough;
+    bool cached = targets.lookup(pc, target);  // Fetch can only redirect to a target it has seen
+    uint32_t penalty = mispredictPenalty(op);
+    bool correct = true;
+
+    if (op == Op::Beq) {
+        bool taken = nextPC != fallThrough;
+        for (size_t kind = 0; kind < predictors.size(); kind++) {
+            uint32_t predicted = cached && predictors[kind].predict(pc) ? target : fallThrough;
+            stats[kind].branches++;
+            if (predicted != nextPC) {
+                stats[kind].branchMisses++;
+                stats[kind].penaltyCycles += penalty;
+                if (kind == static_cast<size_t>(config.kind)) correct = false;
+            }
+            predictors[kind].update(pc, taken);
+        }
+    } else {
+        // Jumps are always taken, so every predictor sees the same BTB and return stack
+        uint32_t predicted = target;
+        if (op == Op::Jr) {
+            returnCount++;
+            returns.pop(predicted);  // Falls back to the BTB when empty
+        } else {
+            jumps++;
+        }
+        if (op == Op::Jal) returns.push(fallThrough);
+        correct = predicted == nextPC;
+        if (!correct) {
+            (op == Op::Jr ? returnMisses : jumpMisses)++;
+            for (BranchStats& predictorStats : stats) predictorStats.penaltyCycles += penalty;
+        }
+    }
+
+    if (nextPC != fallThrough) targets.update(pc, nextPC);
+    return correct;
+}
+
+void BranchPredictionUnit::printStats(uint64_t instructions) const {
+    std::cout << "Branch prediction: " << (stats.empty() ? 0 : stats[0].branches) << " branches, " << jumps << " jumps ("
+              << jumpMisses << " BTB misses), " << returnCount << " returns (" << returnMisses << " return stack misses)"
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t kind = 0; kind < predictors.size(); kind++) {
+        const BranchStats& predictorStats = stats[kind];
+        uint64_t predictions = predictorStats.branches + jumps + returnCount;
+        uint64_t misses = predictorStats.branchMisses + jumpMisses + returnMisses;
+        std::cout << "  " << predictorName(static_cast<PredictorKind>(kind)) << " (" << predictors[kind].bytes()
+                  << " bytes): branch accuracy "
+                  << (predictorStats.branches > 0 ? 100.0 * (predictorStats.branches - predictorStats.branchMisses) / predictorStats.branches : 0)
+                  << "%, overall accuracy " << (predictions > 0 ? 100.0 * (predictions - misses) / predictions : 0) << "%, "
+                  << misses << " mispredictions, MPKI " << (instructions > 0 ? 1000.0 * misses / instructions : 0)
+                  << ", penalty " << predictorStats.penaltyCycles << " cycles"
+                  << (kind == static_cast<size_t>(config.kind) ? " (selected)" : "") << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
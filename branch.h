@@ -0,0 +1,235 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "decode.h"
+
+// Direction predictor for beq
+enum class PredictorKind : uint8_t {
+    NotTaken,    // Static: always falls through
+    Bimodal,     // 2-bit counter per PC
+    Gshare,      // 2-bit counter per PC xor global history
+    Tournament,  // Bimodal and gshare with a per-PC chooser
+    Count,
+};
+
+const char* predictorName(PredictorKind kind);
+
+// Table sizes, shared by every predictor so they compare at equal budgets
+struct PredictorConfig {
+    PredictorKind kind;    // Predictor the pipeline model follows
+    uint32_t tableBits;    // log2 of the counters per table, at most 24
+    uint32_t historyBits;  // Global history length of gshare, at most tableBits
+    uint32_t btbEntries;   // Branch target buffer entries, a power of two
+    uint32_t rasDepth;     // Return address stack entries
+};
+
+constexpr PredictorConfig kDefaultPredictorConfig = {PredictorKind::Gshare, 10, 10, 64, 8};
+
+// Parses "kind[:tableBits[:historyBits[:btbEntries[:rasDepth]]]]" with kind nottaken, bimodal,
+// gshare or tournament. Omitted fields keep their value in config.
+bool parsePredictorConfig(const std::string& text, PredictorConfig& config);
+
+// Fetch slots lost when the successor of op was mispredicted: j and jal resolve in ID,
+// beq and jr in EX
+inline uint32_t mispredictPenalty(Op op) { return op == Op::J || op == Op::Jal ? 1 : 2; }
+
+// 2-bit saturating counters packed four to a byte
+class CounterTable {
+   public:
+    explicit CounterTable(uint32_t bits) : mask((1u << bits) - 1), packed((mask >> 2) + 1, 0x55) {}  // Weakly not taken
+
+    uint32_t get(uint32_t index) const { return (packed[(index & mask) >> 2] >> shift(index)) & 3; }
+    bool taken(uint32_t index) const { return get(index) >= 2; }
+
+    void update(uint32_t index, bool taken) {
+        uint32_t counter = get(index);
+        if (taken ? counter == 3 : counter == 0) return;
+        counter += taken ? 1 : -1;
+        uint8_t& byte = packed[(index & mask) >> 2];
+        byte = static_cast<uint8_t>((byte & ~(3u << shift(index))) | (counter << shift(index)));
+    }
+
+    size_t bytes() const { return packed.size(); }
+
+   private:
+    static uint32_t shift(uint32_t index) { return (index & 3) * 2; }
+
+    uint32_t mask;
+    std::vector<uint8_t> packed;
+};
+
+struct NotTakenPredictor {
+    explicit NotTakenPredictor(const PredictorConfig&) {}
+    bool predict(uint32_t) const { return false; }
+    void update(uint32_t, bool) {}
+    size_t bytes() const { return 0; }
+};
+
+struct BimodalPredictor {
+    explicit BimodalPredictor(const PredictorConfig& config) : counters(config.tableBits) {}
+    bool predict(uint32_t pc) const { return counters.taken(pc >> 2); }
+    void update(uint32_t pc, bool taken) { counters.update(pc >> 2, taken); }
+    size_t bytes() const { return counters.bytes(); }
+
+    CounterTable counters;
+};
+
+struct GsharePredictor {
+    explicit GsharePredictor(const PredictorConfig& config)
+        : counters(config.tableBits), history(0), historyMask((1u << config.historyBits) - 1) {}
+    bool predict(uint32_t pc) const { return counters.taken((pc >> 2) ^ history); }
+    void update(uint32_t pc, bool taken) {
+        counters.update((pc >> 2) ^ history, taken);
+        history = ((history << 1) | taken) & historyMask;
+    }
+    size_t bytes() const { return counters.bytes() + sizeof(history); }
+
+    CounterTable counters;
+    uint32_t history;  // Outcomes of the last branches, newest in bit 0
+    uint32_t historyMask;
+};
+
+// Chooser counters lean towards gshare when taken
+struct TournamentPredictor {
+    explicit TournamentPredictor(const PredictorConfig& config) : local(config), global(config), chooser(config.tableBits) {}
+    bool predict(uint32_t pc) const { return chooser.taken(pc >> 2) ? global.predict(pc) : local.predict(pc); }
+    void update(uint32_t pc, bool taken) {
+        bool localCorrect = local.predict(pc) == taken;
+        bool globalCorrect = global.predict(pc) == taken;
+        if (localCorrect != globalCorrect) chooser.update(pc >> 2, globalCorrect);
+        local.update(pc, taken);
+        global.update(pc, taken);
+    }
+    size_t bytes() const { return local.bytes() + global.bytes() + chooser.bytes(); }
+
+    BimodalPredictor local;
+    GsharePredictor global;
+    CounterTable chooser;
+};
+
+// Direction predictor picked at construction, dispatched like CacheModel
+class DirectionPredictor {
+   public:
+    DirectionPredictor(PredictorKind kind, const PredictorConfig& config);
+
+    bool predict(uint32_t pc) const {
+        return std::visit([pc](const auto& predictor) { return predictor.predict(pc); }, predictor);
+    }
+
+    void update(uint32_t pc, bool taken) {
+        std::visit([pc, taken](auto& predictor) { predictor.update(pc, taken); }, predictor);
+    }
+
+    size_t bytes() const {
+        return std::visit([](const auto& predictor) { return predictor.bytes(); }, predictor);
+    }
+
+   private:
+    using Variant = std::variant<NotTakenPredictor, BimodalPredictor, GsharePredictor, TournamentPredictor>;
+
+    static Variant make(PredictorKind kind, const PredictorConfig& config);
+
+    Variant predictor;
+};
+
+// Direct-mapped branch target buffer of taken control transfers
+class BranchTargetBuffer {
+   public:
+    explicit BranchTargetBuffer(uint32_t entries) : mask(entries - 1), sources(entries, kEmpty), targets(entries) {}
+
+    // Cached target of the transfer at pc, or false
+    bool lookup(uint32_t pc, uint32_t& target) const {
+        uint32_t index = (pc >> 2) & mask;
+        if (sources[index] != pc) return false;
+        target = targets[index];
+        return true;
+    }
+
+    void update(uint32_t pc, uint32_t target) {
+        uint32_t index = (pc >> 2) & mask;
+        sources[index] = pc;
+        targets[index] = target;
+    }
+
+   private:
+    static constexpr uint32_t kEmpty = UINT32_MAX;  // Instructions are word aligned
+
+    uint32_t mask;
+    std::vector<uint32_t> sources;
+    std::vector<uint32_t> targets;
+};
+
+// Return address stack. A push onto a full stack overwrites the oldest entry.
+class ReturnAddressStack {
+   public:
+    explicit ReturnAddressStack(uint32_t depth) : entries(depth), top(0), size(0) {}
+
+    void push(uint32_t address) {
+        if (entries.empty()) return;
+        top = (top + 1) % entries.size();
+        entries[top] = address;
+        size = std::min<size_t>(size + 1, entries.size());
+    }
+
+    // Predicted return address, or false when the stack is empty
+    bool pop(uint32_t& address) {
+        if (size == 0) return false;
+        address = entries[top];
+        top = (top + entries.size() - 1) % entries.size();
+        size--;
+        return true;
+    }
+
+   private:
+    std::vector<uint32_t> entries;
+    size_t top;
+    size_t size;
+};
+
+// Predictions of one direction predictor
+struct BranchStats {
+    uint64_t branches;       // beq executed
+    uint64_t branchMisses;   // beq whose successor was mispredicted
+    uint64_t penaltyCycles;  // Fetch slots lost to every misprediction, jumps included
+};
+
+// Predicts the successor of every control-flow instruction. All direction predictors run
+// side by side on the same branches; jumps share the BTB and jr $ra the return stack.
+class BranchPredictionUnit {
+   public:
+    explicit BranchPredictionUnit(const PredictorConfig& config = kDefaultPredictorConfig);
+
+    // Checks the predictions for decoded at pc against the actual successor nextPC and trains
+    // the tables. Returns whether the selected predictor fetched nextPC; true for
+    // instructions other than beq, j, jal and jr.
+    bool resolve(const DecodedInstruction& decoded, uint32_t pc, uint32_t nextPC) {
+        if (decoded.op != Op::Beq && decoded.op != Op::J && decoded.op != Op::Jal && decoded.op != Op::Jr) return true;
+        return resolveTransfer(decoded.op, pc, nextPC);
+    }
+
+    // Zeroes the counters and empties the tables
+    void reset();
+
+    // Prints accuracy, MPKI and penalty cycles of every predictor over instructions
+    void printStats(uint64_t instructions) const;
+
+    const PredictorConfig& configuration() const { return config; }
+
+   private:
+    bool resolveTransfer(Op op, uint32_t pc, uint32_t nextPC);
+
+    PredictorConfig config;
+    std::vector<DirectionPredictor> predictors;  // One per PredictorKind
+    std::vector<BranchStats> stats;
+    BranchTargetBuffer targets;
+    ReturnAddressStack returns;
+    uint64_t jumps;        // j and jal
+    uint64_t jumpMisses;   // BTB misses on them
+    uint64_t returnCount;  // jr
+    uint64_t returnMisses;
+};
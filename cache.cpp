@@ -1,81 +1,244 @@
 #include "cache.h"
 
-#include <climits>
+#include <algorithm>
+#include <charconv>
+#include <iomanip>
 #include <iostream>
-#include <list>
-#include <unordered_map>
-
-// Node represents a cache entry
-struct LFUCache::Node {
-    uint32_t key;
-    uint32_t value;
-    uint32_t freq;
-    Node(uint32_t k, uint32_t v) : key(k), value(v), freq(1) {}
-};
-
-// Frequency list for each frequency
-struct LFUCache::FreqList {
-    std::list<Node*> nodes;
-};
-
-struct LFUCache::Impl {
-    uint32_t capacity;
-    uint32_t minFreq;
-    // key -> Node*
-    std::unordered_map<uint32_t, Node*> keyMap;
-    // freq -> list of Nodes (LRU at back)
-    std::unordered_map<uint32_t, FreqList> freqMap;
-
-    Impl(uint32_t cap) : capacity(cap), minFreq(0) {}
-    ~Impl() {
-        // cleanup heap-allocated nodes
-        for (auto& kv : keyMap) delete kv.second;
+#include <iterator>
+
+namespace {
+
+bool isPowerOfTwo(uint32_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+uint32_t log2Of(uint32_t value) {
+    uint32_t bits = 0;
+    while ((1u << bits) < value) bits++;
+    return bits;
+}
+
+// Splits off the text up to the next ':' and advances past it
+std::string nextField(const std::string& text, size_t& position) {
+    size_t end = text.find(':', position);
+    if (end == std::string::npos) end = text.size();
+    std::string field = text.substr(position, end - position);
+    position = end < text.size() ? end + 1 : end;
+    return field;
+}
+
+bool parseNumber(const std::string& field, uint32_t& value) {
+    const char* last = field.data() + field.size();
+    auto [end, error] = std::from_chars(field.data(), last, value);
+    return error == std::errc() && end == last;
+}
+
+}  // namespace
+
+bool parseCacheConfig(const std::string& text, CacheConfig& config) {
+    CacheConfig parsed = config;
+    size_t position = 0;
+    std::string size = nextField(text, position);
+    std::string lineSize = nextField(text, position);
+    std::string ways = nextField(text, position);
+    std::string policy = nextField(text, position);
+    std::string writePolicy = nextField(text, position);
+    std::string allocatePolicy = nextField(text, position);
+    if (position != text.size()) return false;  // Trailing fields
+    if (!parseNumber(size, parsed.size) || !parseNumber(lineSize, parsed.lineSize)) return false;
+    if (ways == "full") {
+        parsed.ways = parsed.lineSize != 0 ? parsed.size / parsed.lineSize : 0;
+    } else if (!parseNumber(ways, parsed.ways)) {
+        return false;
+    }
+    if (policy == "lfu") {
+        parsed.policy = ReplacementPolicy::LFU;
+    } else if (policy == "lru") {
+        parsed.policy = ReplacementPolicy::LRU;
+    } else if (policy == "clock") {
+        parsed.policy = ReplacementPolicy::Clock;
+    } else if (policy == "random") {
+        parsed.policy = ReplacementPolicy::Random;
+    } else if (policy == "arc") {
+        parsed.policy = ReplacementPolicy::ARC;
+    } else if (policy == "plru") {
+        parsed.policy = ReplacementPolicy::PLRU;
+    } else if (!policy.empty()) {
+        return false;
+    }
+    if (writePolicy == "wb") {
+        parsed.writeBack = true;
+    } else if (writePolicy == "wt") {
+        parsed.writeBack = false;
+    } else if (!writePolicy.empty()) {
+        return false;
+    }
+    if (allocatePolicy == "wa") {
+        parsed.writeAllocate = true;
+    } else if (allocatePolicy == "nwa") {
+        parsed.writeAllocate = false;
+    } else if (!allocatePolicy.empty()) {
+        return false;
+    }
+
+    if (!isPowerOfTwo(parsed.lineSize) || parsed.lineSize < 4 || parsed.ways == 0 || parsed.ways > kMaxWays) return false;
+    if (parsed.policy == ReplacementPolicy::PLRU && !isPowerOfTwo(parsed.ways)) return false;
+    uint64_t setBytes = static_cast<uint64_t>(parsed.lineSize) * parsed.ways;
+    if (parsed.size % setBytes != 0 || !isPowerOfTwo(static_cast<uint32_t>(parsed.size / setBytes))) return false;
+    config = parsed;
+    return true;
+}
+
+template <typename Policy>
+SetAssociativeCache<Policy>::SetAssociativeCache(const CacheConfig& geometry)
+    : config(geometry),
+      offsetBits(log2Of(geometry.lineSize)),
+      setMask(geometry.size / (geometry.lineSize * geometry.ways) - 1),
+      tagShift(offsetBits + log2Of(setMask + 1)),
+      tags(static_cast<size_t>(setMask + 1) * geometry.ways, kInvalidTag),
+      dirty(tags.size()),
+      accesses(tags.size()),
+      policy(setMask + 1, geometry.ways),
+      counters{} {}
+
+template <typename Policy>
+CacheAccess SetAssociativeCache<Policy>::fill(uint32_t set, uint32_t address, bool dirtyFill) {
+    counters.misses++;
+    counters.insertions++;
+    uint32_t* setTags = &tags[set * config.ways];
+    int freeWay = -1;
+    for (uint32_t way = 0; way < config.ways && freeWay < 0; way++) {
+        if (setTags[way] == kInvalidTag) freeWay = static_cast<int>(way);
+    }
+    uint32_t way = policy.miss(set, tagOf(address), freeWay, setTags);
+    uint32_t line = set * config.ways + way;
+    CacheAccess result{false, true, false, 0};
+    if (freeWay < 0) {
+        counters.evictions++;
+        result.writeback = dirty[line] != 0;
+        result.victimAddress = lineAddress(set, setTags[way]);
+        if (result.writeback) counters.writebacks++;
+    }
+    policy.fill(set, way);
+    setTags[way] = tagOf(address);
+    dirty[line] = dirtyFill;
+    accesses[line] = 1;
+    return result;
+}
+
+template <typename Policy>
+CacheStats SetAssociativeCache<Policy>::snapshot() const {
+    CacheStats stats = counters;
+    std::fill(std::begin(stats.occupancy), std::end(stats.occupancy), 0);
+    for (size_t line = 0; line < tags.size(); line++) {
+        if (tags[line] == kInvalidTag) continue;
+        size_t bucket = 0;
+        while (bucket + 1 < kFrequencyBuckets && accesses[line] >= (2u << bucket)) bucket++;
+        stats.occupancy[bucket]++;
+    }
+    return stats;
+}
+
+template class SetAssociativeCache<LfuPolicy>;
+template class SetAssociativeCache<LruPolicy>;
+template class SetAssociativeCache<ClockPolicy>;
+template class SetAssociativeCache<RandomPolicy>;
+template class SetAssociativeCache<ArcPolicy>;
+template class SetAssociativeCache<TreePlruPolicy>;
+
+CacheModel::CacheModel(const CacheConfig& config) : cache(make(config)) {}
+
+CacheModel::Variant CacheModel::make(const CacheConfig& config) {
+    switch (config.policy) {
+        case ReplacementPolicy::LRU:
+            return SetAssociativeCache<LruPolicy>(config);
+        case ReplacementPolicy::Clock:
+            return SetAssociativeCache<ClockPolicy>(config);
+        case ReplacementPolicy::Random:
+            return SetAssociativeCache<RandomPolicy>(config);
+        case ReplacementPolicy::ARC:
+            return SetAssociativeCache<ArcPolicy>(config);
+        case ReplacementPolicy::PLRU:
+            return SetAssociativeCache<TreePlruPolicy>(config);
+        case ReplacementPolicy::LFU:
+            break;
+    }
+    return SetAssociativeCache<LfuPolicy>(config);
+}
+
+bool parseLatencies(const std::string& text, HierarchyConfig& config) {
+    HierarchyConfig parsed = config;
+    size_t position = 0;
+    for (uint32_t* latency : {&parsed.l1Latency, &parsed.l2Latency, &parsed.l3Latency, &parsed.memoryLatency}) {
+        if (!parseNumber(nextField(text, position), *latency)) return false;
     }
-};
-
-LFUCache::LFUCache(uint32_t capacity) : impl(new Impl(capacity)) {}
-LFUCache::~LFUCache() { delete impl; }
-
-// In your get function
-uint32_t LFUCache::get(uint32_t key) {
-    auto& p = *impl;
-    auto it = p.keyMap.find(key);
-    if (it == p.keyMap.end()) {
-        // Miss
-        std::cout << "Cache MISS: key 0x" << std::hex << key << std::dec << std::endl;
-        return UINT32_MAX;
+    if (position != text.size() || parsed.l1Latency == 0) return false;
+    config = parsed;
+    return true;
+}
+
+MemoryHierarchy::MemoryHierarchy(const HierarchyConfig& hierarchy) : config(hierarchy), memoryTraffic{} {
+    levels.emplace_back(config.l2);
+    latencies.push_back(config.l2Latency);
+    if (config.hasL3) {
+        levels.emplace_back(config.l3);
+        latencies.push_back(config.l3Latency);
+    }
+}
+
+// Cycles to bring bytes at address from level (levels.size() is memory) into the level above
+uint32_t MemoryHierarchy::load(size_t level, uint32_t address, uint32_t bytes) {
+    if (level == levels.size()) {
+        memoryTraffic.readTransactions++;
+        memoryTraffic.readBytes += bytes;
+        return config.memoryLatency;
     }
-    // Hit
-    std::cout << "Cache HIT: key 0x" << std::hex << key << std::dec << ", freq now " << (it->second->freq + 1) << std::endl;
-    Node* node = it->second;
-    auto& oldList = p.freqMap[node->freq].nodes;
-    oldList.remove(node);
-    if (oldList.empty() && node->freq == p.minFreq) p.minFreq++;
-    node->freq++;
-    p.freqMap[node->freq].nodes.push_front(node);
-    return node->value;
+    CacheModel& cache = levels[level];
+    uint32_t lineSize = cache.geometry().lineSize;
+    CacheAccess result = cache.read(address);
+    if (result.writeback) writeBack(level + 1, result.victimAddress, lineSize);
+    uint32_t cycles = latencies[level];
+    if (result.filled) cycles += load(level + 1, address, lineSize);
+    return cycles;
 }
 
-void LFUCache::put(uint32_t key, uint32_t value) {
-    auto& p = *impl;
-    if (p.capacity == 0) return;
-    auto it = p.keyMap.find(key);
-    if (it != p.keyMap.end()) {
-        it->second->value = value;
-        get(key);  // already prints cache hit
+// Writes bytes at address into level
+void MemoryHierarchy::store(size_t level, uint32_t address, uint32_t bytes) {
+    if (level == levels.size()) {
+        memoryTraffic.writeTransactions++;
+        memoryTraffic.writeBytes += bytes;
         return;
     }
-    if (p.keyMap.size() >= p.capacity) {
-        auto& lfuList = p.freqMap[p.minFreq].nodes;
-        Node* toRemove = lfuList.back();
-        std::cout << "Cache EVICT: key 0x" << std::hex << toRemove->key << std::dec << " (freq " << toRemove->freq << ")" << std::endl;
-        p.keyMap.erase(toRemove->key);
-        lfuList.pop_back();
-        delete toRemove;
+    CacheModel& cache = levels[level];
+    const CacheConfig& geometry = cache.geometry();
+    CacheAccess result = cache.write(address);
+    if (result.writeback) writeBack(level + 1, result.victimAddress, geometry.lineSize);
+    if (result.filled) load(level + 1, address, geometry.lineSize);  // Buffered: the fill does not stall
+    if (!(geometry.writeBack && (result.hit || result.filled))) store(level + 1, address, bytes);
+}
+
+void MemoryHierarchy::flush(CacheModel& l1) {
+    l1.flush([&](uint32_t line) { writeBack(0, line, l1.geometry().lineSize); });
+    for (size_t level = 0; level < levels.size(); level++) {
+        levels[level].flush([&](uint32_t line) { writeBack(level + 1, line, levels[level].geometry().lineSize); });
+    }
+}
+
+void printCacheStats(const std::string& name, const CacheModel& cache) {
+    CacheStats stats = cache.snapshot();
+    uint64_t accesses = stats.hits + stats.misses;
+    std::cout << name << ": " << accesses << " accesses, " << stats.hits << " hits, " << stats.misses << " misses ("
+              << std::fixed << std::setprecision(2) << (accesses > 0 ? 100.0 * stats.hits / accesses : 0) << "% hits)"
+              << std::defaultfloat << ", " << stats.insertions << " insertions, " << stats.evictions << " evictions, "
+              << stats.writebacks << " write-backs, " << stats.invalidations << " invalidations; lines by accesses";
+    for (size_t bucket = 0; bucket < kFrequencyBuckets; bucket++) {
+        if (stats.occupancy[bucket] == 0) continue;
+        uint32_t low = 1u << bucket;
+        std::cout << " " << low;
+        if (bucket + 1 == kFrequencyBuckets) {
+            std::cout << "+";
+        } else if (low > 1) {
+            std::cout << "-" << (2 * low - 1);
+        }
+        std::cout << ":" << stats.occupancy[bucket];
     }
-    Node* node = new Node(key, value);
-    p.keyMap[key] = node;
-    p.freqMap[1].nodes.push_front(node);
-    p.minFreq = 1;
-    std::cout << "Cache PUT: key 0x" << std::hex << key << std::dec << std::endl;
+    std::cout << std::endl;
 }
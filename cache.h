@@ -1,20 +1,283 @@
 #pragma once
 #include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
 
-class LFUCache {
+#include "replacement.h"
+
+// Line chosen for eviction when a set is full
+enum class ReplacementPolicy : uint8_t {
+    LFU,    // Fewest accesses, least recently used among equals
+    LRU,    // Least recently used
+    Clock,  // Second chance
+    Random,
+    ARC,    // Adaptive replacement
+    PLRU,   // Tree pseudo-LRU, power-of-two ways only
+};
+
+// Cache geometry. size / (lineSize * ways) sets, which must be a power of two.
+struct CacheConfig {
+    uint32_t size;      // Total capacity in bytes
+    uint32_t lineSize;  // Bytes per line, a power of two of at least 4
+    uint32_t ways;      // Lines per set, at most kMaxWays; size / lineSize is fully associative
+    ReplacementPolicy policy;
+    bool writeBack;      // Writes dirty the line (write-back) or also go below (write-through)
+    bool writeAllocate;  // A write miss fills the line
+};
+
+constexpr uint32_t kMaxWays = 4096;
+
+// Twelve fully associative word-sized lines with LFU replacement, write-through, write-allocate
+constexpr CacheConfig kDefaultCacheConfig = {48, 4, 12, ReplacementPolicy::LFU, false, true};
+
+// Parses "size:lineSize:ways[:policy[:wb|wt[:wa|nwa]]]" with policy lfu, lru, clock, random,
+// arc or plru; ways may be "full". Omitted fields keep their value in config. Returns false
+// for a malformed or inconsistent geometry.
+bool parseCacheConfig(const std::string& text, CacheConfig& config);
+
+// Outcome of one cache access
+struct CacheAccess {
+    bool hit;
+    bool filled;             // A line was allocated for the access
+    bool writeback;          // A dirty line was evicted to make room
+    uint32_t victimAddress;  // Address of that line
+};
+
+// Resident lines are grouped by accesses since their fill: bucket i holds the lines with
+// 2^i to 2^(i+1) - 1 accesses, and the last bucket everything above
+constexpr size_t kFrequencyBuckets = 8;
+
+// Event counters of one cache. The counters are plain increments on the access path;
+// occupancy is only computed by snapshot().
+struct CacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;     // Lines filled
+    uint64_t evictions;      // Valid lines replaced by a fill
+    uint64_t writebacks;     // Dirty lines evicted or flushed
+    uint64_t invalidations;  // Lines dropped by invalidate
+    uint32_t occupancy[kFrequencyBuckets];
+};
+
+// Set-associative cache model with the replacement policy as a template parameter. Only
+// tags are kept; the data itself always comes from guest memory. An address splits into
+// tag | set index | line offset, and the tags of one set are contiguous in a flat array.
+template <typename Policy>
+class SetAssociativeCache {
    public:
-    explicit LFUCache(uint32_t capacity);
-    ~LFUCache();
+    explicit SetAssociativeCache(const CacheConfig& config);
+
+    // Reads the line holding address, filling it on a miss
+    CacheAccess read(uint32_t address) {
+        uint32_t set = setOf(address);
+        int way = findWay(set, tagOf(address));
+        if (way < 0) return fill(set, address, false);
+        hit(set, static_cast<uint32_t>(way));
+        return CacheAccess{true, false, false, 0};
+    }
 
-    // Returns value if found, or UINT32_MAX as a "not found" marker
-    uint32_t get(uint32_t key);
+    // Writes to the line holding address. A write-back cache marks the line dirty. A miss
+    // allocates the line only with write-allocate.
+    CacheAccess write(uint32_t address) {
+        uint32_t set = setOf(address);
+        int way = findWay(set, tagOf(address));
+        if (way < 0) {
+            if (config.writeAllocate) return fill(set, address, config.writeBack);
+            counters.misses++;
+            return CacheAccess{false, false, false, 0};
+        }
+        hit(set, static_cast<uint32_t>(way));
+        if (config.writeBack) dirty[set * config.ways + way] = 1;
+        return CacheAccess{true, false, false, 0};
+    }
 
-    // Sets key to value in cache
-    void put(uint32_t key, uint32_t value);
+    // Drops the line holding address, if cached. Used to keep an instruction cache coherent
+    // with stores into code, so a dirty line is discarded rather than written back.
+    bool invalidate(uint32_t address) {
+        uint32_t set = setOf(address);
+        int way = findWay(set, tagOf(address));
+        if (way < 0) return false;
+        tags[set * config.ways + way] = kInvalidTag;
+        dirty[set * config.ways + way] = 0;
+        counters.invalidations++;
+        return true;
+    }
+
+    // Cleans every dirty line, calling writeBack(lineAddress) for each
+    template <typename WriteBack>
+    void flush(WriteBack&& writeBack) {
+        for (size_t line = 0; line < tags.size(); line++) {
+            if (!dirty[line]) continue;
+            dirty[line] = 0;
+            counters.writebacks++;
+            writeBack(lineAddress(static_cast<uint32_t>(line / config.ways), tags[line]));
+        }
+    }
+
+    // Counters since construction or the last resetStats, with the current occupancy
+    CacheStats snapshot() const;
+
+    // Zeroes the counters; the cached lines are kept
+    void resetStats() { counters = CacheStats{}; }
+
+    const CacheConfig& geometry() const { return config; }
 
    private:
-    struct Node;
-    struct FreqList;
-    struct Impl;
-    Impl* impl;
+    uint32_t setOf(uint32_t address) const { return (address >> offsetBits) & setMask; }
+    uint32_t tagOf(uint32_t address) const { return address >> tagShift; }
+
+    // Way of set holding tag, or -1
+    int findWay(uint32_t set, uint32_t tag) const {
+        const uint32_t* setTags = &tags[set * config.ways];
+        for (uint32_t way = 0; way < config.ways; way++) {
+            if (setTags[way] == tag) return static_cast<int>(way);
+        }
+        return -1;
+    }
+
+    void hit(uint32_t set, uint32_t way) {
+        policy.hit(set, way);
+        accesses[set * config.ways + way]++;
+        counters.hits++;
+    }
+
+    // Rebuilds a line's address from its tag and set index
+    uint32_t lineAddress(uint32_t set, uint32_t tag) const { return (tag << tagShift) | (set << offsetBits); }
+
+    CacheAccess fill(uint32_t set, uint32_t address, bool dirtyFill);
+
+    CacheConfig config;
+    uint32_t offsetBits;  // log2(lineSize)
+    uint32_t setMask;     // Sets - 1
+    uint32_t tagShift;    // offsetBits + log2(sets)
+    std::vector<uint32_t> tags;      // sets x ways, kInvalidTag when empty
+    std::vector<uint8_t> dirty;      // Per line: modified since the fill (write-back only)
+    std::vector<uint32_t> accesses;  // Per line: accesses since the fill
+    Policy policy;
+    CacheStats counters;
+};
+
+// Cache whose policy is picked from its configuration at construction. Each access
+// dispatches once on the variant index into a fully inlined SetAssociativeCache<Policy>.
+class CacheModel {
+   public:
+    explicit CacheModel(const CacheConfig& config);
+
+    CacheAccess read(uint32_t address) {
+        return std::visit([address](auto& cache) { return cache.read(address); }, cache);
+    }
+
+    CacheAccess write(uint32_t address) {
+        return std::visit([address](auto& cache) { return cache.write(address); }, cache);
+    }
+
+    bool invalidate(uint32_t address) {
+        return std::visit([address](auto& cache) { return cache.invalidate(address); }, cache);
+    }
+
+    template <typename WriteBack>
+    void flush(WriteBack&& writeBack) {
+        std::visit([&writeBack](auto& cache) { cache.flush(writeBack); }, cache);
+    }
+
+    CacheStats snapshot() const {
+        return std::visit([](const auto& cache) { return cache.snapshot(); }, cache);
+    }
+
+    void resetStats() {
+        std::visit([](auto& cache) { cache.resetStats(); }, cache);
+    }
+
+    const CacheConfig& geometry() const {
+        return std::visit([](const auto& cache) -> const CacheConfig& { return cache.geometry(); }, cache);
+    }
+
+   private:
+    using Variant = std::variant<SetAssociativeCache<LfuPolicy>, SetAssociativeCache<LruPolicy>,
+                                 SetAssociativeCache<ClockPolicy>, SetAssociativeCache<RandomPolicy>,
+                                 SetAssociativeCache<ArcPolicy>, SetAssociativeCache<TreePlruPolicy>>;
+
+    static Variant make(const CacheConfig& config);
+
+    Variant cache;
+};
+
+// Prints one line of counters and occupancy for cache under name
+void printCacheStats(const std::string& name, const CacheModel& cache);
+
+// Levels behind the split L1 caches and the cycles each one takes to answer
+struct HierarchyConfig {
+    CacheConfig l2;          // Unified second level
+    bool hasL3;              // Third level present
+    CacheConfig l3;          // Unified third level, used when hasL3
+    uint32_t l1Latency;      // Cycles for an L1 hit, at least 1
+    uint32_t l2Latency;      // Additional cycles to reach L2
+    uint32_t l3Latency;      // Additional cycles to reach L3
+    uint32_t memoryLatency;  // Additional cycles to reach memory
+};
+
+constexpr HierarchyConfig kDefaultHierarchyConfig = {{4096, 16, 4, ReplacementPolicy::LRU, true, true},
+                                                     false,
+                                                     {65536, 64, 8, ReplacementPolicy::LRU, true, true},
+                                                     1,
+                                                     10,
+                                                     30,
+                                                     100};
+
+// Parses "l1:l2:l3:memory" hit latencies in cycles into config
+bool parseLatencies(const std::string& text, HierarchyConfig& config);
+
+// Transfers between the last cache level and memory
+struct MemoryTraffic {
+    uint64_t readTransactions;   // Line fills
+    uint64_t readBytes;
+    uint64_t writeTransactions;  // Write-throughs and write-backs
+    uint64_t writeBytes;
+    uint64_t writebacks;         // Dirty lines written back by any level, on eviction or flush
+};
+
+// Unified L2 and optional L3 shared by the instruction and data L1 caches. Levels are neither
+// inclusive nor exclusive: a line is filled into every level it missed in, and evictions
+// are not propagated upwards. Writes (write-throughs and write-backs) are buffered, so only
+// line fills stall the access.
+class MemoryHierarchy {
+   public:
+    explicit MemoryHierarchy(const HierarchyConfig& config);
+
+    // Reads or writes address through l1 and returns the cycles taken. A miss looks the line
+    // up in L2, then L3, then memory, filling each level that missed.
+    uint32_t access(CacheModel& l1, uint32_t address, bool write) {
+        CacheAccess result = write ? l1.write(address) : l1.read(address);
+        uint32_t cycles = config.l1Latency;
+        if (result.writeback) writeBack(0, result.victimAddress, l1.geometry().lineSize);
+        if (result.filled) cycles += load(0, address, l1.geometry().lineSize);
+        if (write && !(l1.geometry().writeBack && (result.hit || result.filled))) {
+            store(0, address, 4);  // Write-through, or a write miss that did not allocate
+        }
+        return cycles;
+    }
+
+    // Writes every dirty line of l1 and then of each lower level down to memory
+    void flush(CacheModel& l1);
+
+    const MemoryTraffic& traffic() const { return memoryTraffic; }
+
+    // L2, then L3 when present
+    const std::vector<CacheModel>& lowerLevels() const { return levels; }
+
+   private:
+    uint32_t load(size_t level, uint32_t address, uint32_t bytes);
+    void store(size_t level, uint32_t address, uint32_t bytes);
+
+    // Stores a dirty line evicted or flushed from the level above
+    void writeBack(size_t level, uint32_t address, uint32_t bytes) {
+        memoryTraffic.writebacks++;
+        store(level, address, bytes);
+    }
+
+    HierarchyConfig config;
+    std::vector<CacheModel> levels;   // L2, then L3 when present
+    std::vector<uint32_t> latencies;  // Additional cycles to reach each level
+    MemoryTraffic memoryTraffic;
 };
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+// Operation of a decoded instruction, one per executor case
+enum class Op : uint8_t {
+    Add,
+    Sub,
+    And,
+    Or,
+    Slt,
+    Mult,      // No ALU support; writes 0 to rd like any unknown R-type
+    Div,       // No ALU support; writes 0 to rd like any unknown R-type
+    Mfhi,      // No ALU support; writes 0 to rd like any unknown R-type
+    Mflo,      // No ALU support; writes 0 to rd like any unknown R-type
+    UnknownR,  // Any other R-type funct (add.s included); writes 0 to rd
+    Jr,
+    Syscall,
+    Addi,
+    Lw,
+    Sw,
+    Beq,
+    J,
+    Jal,
+    Nop,  // Opcodes with no control signals set (lui, li, lwc1, swc1)
+};
+
+// Control signals of the single-cycle datapath packed into one word
+enum ControlFlag : uint16_t {
+    kRegDst = 1 << 0,
+    kBranch = 1 << 1,
+    kReadMem = 1 << 2,
+    kMemtoReg = 1 << 3,
+    kWriteMem = 1 << 4,
+    kALUSrc = 1 << 5,
+    kWriteReg = 1 << 6,
+    kALUOp0 = 1 << 7,
+    kALUOp1 = 1 << 8,
+    kJump = 1 << 9,
+};
+
+// Instruction word decoded once after assembly, 16 bytes so four share a host cache line
+struct DecodedInstruction {
+    Op op;
+    uint8_t rs;         // Source register 1
+    uint8_t rt;         // Source register 2
+    uint8_t rd;         // Destination register (rd for R-type, rt otherwise)
+    uint16_t signals;   // ControlFlag bits computed by setControlSignal
+    uint16_t reserved;  // Padding
+    uint32_t imm;       // addi: zero-extended immediate, lw/sw: sign-extended offset, beq/j/jal: target address
+    uint32_t raw;       // Instruction word as fetched from memory
+};
+
+static_assert(sizeof(DecodedInstruction) == 16, "DecodedInstruction should stay 16 bytes");
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// MIPS instruction word layouts
+enum class Format : uint8_t {
+    R,  // opcode | rs | rt | rd | shamt | funct
+    I,  // opcode | rs | rt | immediate
+    J,  // opcode | target
+};
+
+// Instructions the assembler can encode (pseudo-instructions expand to these)
+enum class Mnemonic : uint8_t {
+    Add,
+    Sub,
+    Mult,
+    Div,
+    Mflo,
+    Mfhi,
+    And,
+    Or,
+    Slt,
+    Move,  // add rd, rs, $zero
+    Jr,
+    Syscall,
+    AddS,  // Encoded with opcode 0 and funct 0
+    Addi,
+    Li,  // addiu rt, $zero, imm
+    Lui,
+    Lw,
+    Sw,
+    Lwc1,
+    Swc1,
+    Beq,
+    J,
+    Jal,
+    La,  // lui rt, upper; addi rt, rt, lower
+    Count,
+};
+
+struct InstructionFormat {
+    Format format;
+    uint8_t opcode;
+    uint8_t funct;  // R-type only
+};
+
+// Format descriptors indexed by Mnemonic
+constexpr InstructionFormat kInstructionFormats[] = {
+    {Format::R, 0x00, 0x20},  // add
+    {Format::R, 0x00, 0x22},  // sub
+    {Format::R, 0x00, 0x18},  // mult
+    {Format::R, 0x00, 0x1A},  // div
+    {Format::R, 0x00, 0x12},  // mflo
+    {Format::R, 0x00, 0x10},  // mfhi
+    {Format::R, 0x00, 0x24},  // and
+    {Format::R, 0x00, 0x25},  // or
+    {Format::R, 0x00, 0x2A},  // slt
+    {Format::R, 0x00, 0x20},  // move
+    {Format::R, 0x00, 0x08},  // jr
+    {Format::R, 0x00, 0x0C},  // syscall
+    {Format::R, 0x00, 0x00},  // add.s
+    {Format::I, 0x08, 0},     // addi
+    {Format::I, 0x09, 0},     // li
+    {Format::I, 0x0F, 0},     // lui
+    {Format::I, 0x23, 0},     // lw
+    {Format::I, 0x2B, 0},     // sw
+    {Format::I, 0x31, 0},     // lwc1
+    {Format::I, 0x39, 0},     // swc1
+    {Format::I, 0x04, 0},     // beq
+    {Format::J, 0x02, 0},     // j
+    {Format::J, 0x03, 0},     // jal
+    {Format::I, 0x0F, 0},     // la (first word of the expansion)
+};
+
+static_assert(sizeof(kInstructionFormats) / sizeof(kInstructionFormats[0]) == static_cast<size_t>(Mnemonic::Count),
+              "every mnemonic needs a format descriptor");
+
+constexpr uint32_t encodeR(uint32_t opcode, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t shamt, uint32_t funct) {
+    return (opcode & 0x3F) << 26 | (rs & 0x1F) << 21 | (rt & 0x1F) << 16 | (rd & 0x1F) << 11 | (shamt & 0x1F) << 6 | (funct & 0x3F);
+}
+
+constexpr uint32_t encodeI(uint32_t opcode, uint32_t rs, uint32_t rt, uint32_t immediate) {
+    return (opcode & 0x3F) << 26 | (rs & 0x1F) << 21 | (rt & 0x1F) << 16 | (immediate & 0xFFFF);
+}
+
+constexpr uint32_t encodeJ(uint32_t opcode, uint32_t target) { return (opcode & 0x3F) << 26 | (target & 0x03FFFFFF); }
+
+// Encodes one instruction word. R-type uses rs, rt and rd; I-type uses rs, rt and the low
+// 16 bits of immediate; J-type uses the low 26 bits of immediate as the target field.
+constexpr uint32_t encode(Mnemonic mnemonic, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t immediate) {
+    const InstructionFormat& format = kInstructionFormats[static_cast<size_t>(mnemonic)];
+    switch (format.format) {
+        case Format::R:
+            return encodeR(format.opcode, rs, rt, rd, 0, format.funct);
+        case Format::I:
+            return encodeI(format.opcode, rs, rt, immediate);
+        default:
+            return encodeJ(format.opcode, immediate);
+    }
+}
+
+static_assert(encode(Mnemonic::Add, 8, 9, 10, 0) == 0x01095020, "add $t2, $t0, $t1");
+static_assert(encode(Mnemonic::Lw, 1, 8, 0, 0) == 0x8C280000, "lw $t0, 0($at)");
+static_assert(encode(Mnemonic::Beq, 15, 24, 0, 2) == 0x11F80002, "beq $t7, $t8, +2");
+static_assert(encode(Mnemonic::J, 0, 0, 0, 0x43) == 0x08000043, "j 0x10c");
+static_assert(encode(Mnemonic::Syscall, 0, 0, 0, 0) == 0x0000000C, "syscall");
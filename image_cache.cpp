@@ -0,0 +1,248 @@
+#include "image_cache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MIPS_IMAGE_MMAP 1
+#endif
+
+// Image layout (native byte order, every record padded to 4 bytes):
+//   ImageHeader
+//   segmentCount x { uint32 address, uint32 size, bytes }
+//   lineCount x uint32 source line
+//   symbolCount x { uint32 value, uint32 nameLength, name }, then labelCount labels and
+//   labelStartCount label starts alike
+namespace {
+
+constexpr char kImageMagic[8] = {'M', 'I', 'P', 'S', 'I', 'M', 'G', 0};
+
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t segmentCount;
+    uint64_t sourceHash;
+    uint32_t textEnd;
+    uint32_t dataEnd;
+    uint32_t lineCount;
+    uint32_t symbolCount;
+    uint32_t labelCount;
+    uint32_t labelStartCount;
+};
+
+size_t padded(size_t size) { return (size + 3) & ~static_cast<size_t>(3); }
+
+class Writer {
+   public:
+    void word(uint32_t value) { bytes(&value, sizeof(value)); }
+
+    void bytes(const void* source, size_t count) {
+        const uint8_t* first = static_cast<const uint8_t*>(source);
+        buffer.insert(buffer.end(), first, first + count);
+        buffer.resize(buffer.size() + (padded(count) - count), 0);
+    }
+
+    void names(const std::unordered_map<std::string, uint32_t>& table) {
+        for (const auto& entry : table) {
+            word(entry.second);
+            word(static_cast<uint32_t>(entry.first.size()));
+            bytes(entry.first.data(), entry.first.size());
+        }
+    }
+
+    std::vector<uint8_t> buffer;
+};
+
+// Bounds-checked cursor over the mapped file
+class Reader {
+   public:
+    Reader(const uint8_t* data, size_t size) : cursor(data), end(data + size) {}
+
+    const uint8_t* take(size_t count) {
+        if (static_cast<size_t>(end - cursor) < padded(count)) return nullptr;
+        const uint8_t* result = cursor;
+        cursor += padded(count);
+        return result;
+    }
+
+    bool word(uint32_t& value) {
+        const uint8_t* bytes = take(sizeof(value));
+        if (bytes == nullptr) return false;
+        std::memcpy(&value, bytes, sizeof(value));
+        return true;
+    }
+
+    bool names(uint32_t count, std::vector<std::pair<std::string_view, uint32_t>>& table) {
+        table.clear();
+        table.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t value, length;
+            if (!word(value) || !word(length)) return false;
+            const uint8_t* name = take(length);
+            if (name == nullptr) return false;
+            table.emplace_back(std::string_view(reinterpret_cast<const char*>(name), length), value);
+        }
+        return true;
+    }
+
+    bool atEnd() const { return cursor == end; }
+
+   private:
+    const uint8_t* cursor;
+    const uint8_t* end;
+};
+
+// Writes bytes to a new uniquely named file beside path and returns its name in temporary
+bool writeTemporary(const std::string& path, const std::vector<uint8_t>& bytes, std::string& temporary) {
+#ifdef MIPS_IMAGE_MMAP
+    std::vector<char> name(path.begin(), path.end());
+    const char suffix[] = ".XXXXXX";
+    name.insert(name.end(), suffix, suffix + sizeof(suffix));
+    int fd = mkstemp(name.data());
+    if (fd < 0) return false;
+    temporary = name.data();
+    fchmod(fd, 0644);  // mkstemp creates the file readable by its owner only
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t count = ::write(fd, bytes.data() + written, bytes.size() - written);
+        if (count <= 0) break;
+        written += static_cast<size_t>(count);
+    }
+    if (::close(fd) != 0 || written != bytes.size()) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+#else
+    temporary = path + "." + std::to_string(std::random_device()());
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    file.close();
+    if (!file) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+#endif
+}
+
+}  // namespace
+
+uint64_t hashSource(std::string_view source) {
+    uint64_t hash = 14695981039346656037ull ^ kImageVersion;
+    for (char c : source) hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    return hash;
+}
+
+bool writeImage(const std::string& path, uint64_t sourceHash, uint32_t textEnd, uint32_t dataEnd,
+                const std::vector<ImageSegment>& segments, const std::vector<uint32_t>& sourceLines,
+                const std::unordered_map<std::string, uint32_t>& symbols,
+                const std::unordered_map<std::string, uint32_t>& labels,
+                const std::unordered_map<std::string, uint32_t>& labelStarts) {
+    ImageHeader header{};
+    std::memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+    header.version = kImageVersion;
+    header.segmentCount = static_cast<uint32_t>(segments.size());
+    header.sourceHash = sourceHash;
+    header.textEnd = textEnd;
+    header.dataEnd = dataEnd;
+    header.lineCount = static_cast<uint32_t>(sourceLines.size());
+    header.symbolCount = static_cast<uint32_t>(symbols.size());
+    header.labelCount = static_cast<uint32_t>(labels.size());
+    header.labelStartCount = static_cast<uint32_t>(labelStarts.size());
+
+    Writer writer;
+    writer.bytes(&header, sizeof(header));
+    for (const ImageSegment& segment : segments) {
+        writer.word(segment.address);
+        writer.word(segment.size);
+        writer.bytes(segment.bytes, segment.size);
+    }
+    writer.bytes(sourceLines.data(), sourceLines.size() * sizeof(uint32_t));
+    writer.names(symbols);
+    writer.names(labels);
+    writer.names(labelStarts);
+
+    // Every writer gets its own temporary file next to path, so concurrent runs never write
+    // into a file another one is about to rename
+    std::string temporary;
+    if (!writeTemporary(path, writer.buffer, temporary)) return false;
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        std::ifstream existing(path, std::ios::binary);
+        return static_cast<bool>(existing);  // Another run put its image in place first
+    }
+    return true;
+}
+
+MappedImage::MappedImage() : data(nullptr), size(0), image{} {}
+
+MappedImage::~MappedImage() {
+#ifdef MIPS_IMAGE_MMAP
+    if (data != nullptr && fallback.empty()) munmap(const_cast<uint8_t*>(data), size);
+#endif
+}
+
+bool MappedImage::open(const std::string& path, uint64_t sourceHash) {
+#ifdef MIPS_IMAGE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(ImageHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) return false;
+    data = static_cast<const uint8_t*>(mapping);
+    size = static_cast<size_t>(status.st_size);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    fallback.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = fallback.data();
+    size = fallback.size();
+#endif
+    return parse(sourceHash);
+}
+
+bool MappedImage::parse(uint64_t sourceHash) {
+    Reader reader(data, size);
+    ImageHeader header;
+    const uint8_t* headerBytes = reader.take(sizeof(header));
+    if (headerBytes == nullptr) return false;
+    std::memcpy(&header, headerBytes, sizeof(header));
+    if (std::memcmp(header.magic, kImageMagic, sizeof(kImageMagic)) != 0 || header.version != kImageVersion ||
+        header.sourceHash != sourceHash) {
+        return false;
+    }
+
+    image.textEnd = header.textEnd;
+    image.dataEnd = header.dataEnd;
+    image.segments.clear();
+    for (uint32_t i = 0; i < header.segmentCount; i++) {
+        ImageSegment segment;
+        if (!reader.word(segment.address) || !reader.word(segment.size)) return false;
+        segment.bytes = reader.take(segment.size);
+        if (segment.bytes == nullptr) return false;
+        image.segments.push_back(segment);
+    }
+
+    const uint8_t* lines = reader.take(static_cast<size_t>(header.lineCount) * sizeof(uint32_t));
+    if (lines == nullptr) return false;
+    image.sourceLines = reinterpret_cast<const uint32_t*>(lines);  // 4-byte aligned within the page-aligned mapping
+    image.lineCount = header.lineCount;
+
+    return reader.names(header.symbolCount, image.symbols) && reader.names(header.labelCount, image.labels) &&
+           reader.names(header.labelStartCount, image.labelStarts) && reader.atEnd();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Bump whenever the image layout or the assembler output changes
+constexpr uint32_t kImageVersion = 2;
+
+// 64-bit FNV-1a hash of the source text, salted with kImageVersion
+uint64_t hashSource(std::string_view source);
+
+// Run of guest memory bytes starting at address
+struct ImageSegment {
+    uint32_t address;
+    const uint8_t* bytes;
+    uint32_t size;
+};
+
+// Assembled program state stored in an image
+struct ImageContents {
+    uint32_t textEnd;                    // First address past the encoded text
+    uint32_t dataEnd;                    // First free .data address
+    std::vector<ImageSegment> segments;  // Applied in order; later segments overwrite earlier ones
+    const uint32_t* sourceLines;         // Source line of each text word
+    uint32_t lineCount;
+    std::vector<std::pair<std::string_view, uint32_t>> symbols;  // .data variables
+    std::vector<std::pair<std::string_view, uint32_t>> labels;   // .text labels
+    std::vector<std::pair<std::string_view, uint32_t>> labelStarts;  // Address of each label's first word
+};
+
+// Writes an image for source text with the given hash. Each call writes its own temporary file
+// and renames it into place, so concurrent runs never see a partial image; losing the rename
+// to another run counts as success. Returns false on I/O errors.
+bool writeImage(const std::string& path, uint64_t sourceHash, uint32_t textEnd, uint32_t dataEnd,
+                const std::vector<ImageSegment>& segments, const std::vector<uint32_t>& sourceLines,
+                const std::unordered_map<std::string, uint32_t>& symbols,
+                const std::unordered_map<std::string, uint32_t>& labels,
+                const std::unordered_map<std::string, uint32_t>& labelStarts);
+
+// Read-only mapping of an image file. Contents point into the mapping and stay valid until
+// the MappedImage is destroyed.
+class MappedImage {
+   public:
+    MappedImage();
+    ~MappedImage();
+    MappedImage(const MappedImage&) = delete;
+    MappedImage& operator=(const MappedImage&) = delete;
+
+    // Maps path and checks that it is a well-formed image built from source with sourceHash
+    bool open(const std::string& path, uint64_t sourceHash);
+
+    const ImageContents& contents() const { return image; }
+
+   private:
+    bool parse(uint64_t sourceHash);
+
+    const uint8_t* data;
+    size_t size;
+    std::vector<uint8_t> fallback;  // File contents where mmap is unavailable
+    ImageContents image;
+};
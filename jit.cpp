@@ -0,0 +1,276 @@
+#include "jit.h"
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define MIPS_JIT_X86_64 1
+#endif
+
+namespace {
+
+constexpr size_t kMaxBlockCodeSize = 4096;  // Upper bound for one translated block
+
+constexpr uint8_t kExecutedOffset = offsetof(JitContext, executed);
+constexpr uint8_t kLoadOffset = offsetof(JitContext, load);
+constexpr uint8_t kStoreOffset = offsetof(JitContext, store);
+
+// x86-64 emitter. Register use in translated code:
+//   rbx = guest register array, rbp = JitContext, eax = scratch and return value
+class Emitter {
+   public:
+    explicit Emitter(uint8_t* start) : cursor(start) {}
+
+    uint8_t* position() const { return cursor; }
+
+    void prologue() {
+        bytes({0x55});                    // push rbp
+        bytes({0x53});                    // push rbx
+        bytes({0x48, 0x83, 0xEC, 0x08});  // sub rsp, 8 (keeps helper calls 16-byte aligned)
+        bytes({0x48, 0x89, 0xFD});        // mov rbp, rdi
+        bytes({0x48, 0x8B, 0x5D, 0x00});  // mov rbx, [rbp + registers]
+    }
+
+    // mov eax, [rbx + reg * 4]
+    void loadGuest(uint8_t reg) { bytes({0x8B, 0x43, static_cast<uint8_t>(reg * 4)}); }
+
+    // mov [rbx + reg * 4], eax
+    void storeGuest(uint8_t reg) { bytes({0x89, 0x43, static_cast<uint8_t>(reg * 4)}); }
+
+    // add/sub/and/or/cmp eax, [rbx + reg * 4]
+    void aluGuest(uint8_t opcode, uint8_t reg) { bytes({opcode, 0x43, static_cast<uint8_t>(reg * 4)}); }
+
+    // mov dword [rbx + reg * 4], value
+    void storeGuestImm(uint8_t reg, uint32_t value) {
+        bytes({0xC7, 0x43, static_cast<uint8_t>(reg * 4)});
+        imm32(value);
+    }
+
+    // mov eax, value
+    void movImm(uint32_t value) {
+        bytes({0xB8});
+        imm32(value);
+    }
+
+    // add eax, value
+    void addImm(uint32_t value) {
+        bytes({0x05});
+        imm32(value);
+    }
+
+    // setl al; movzx eax, al
+    void setLess() { bytes({0x0F, 0x9C, 0xC0, 0x0F, 0xB6, 0xC0}); }
+
+    // Calls a JitContext helper with (context, eax, [rbx + valueReg * 4] when storing)
+    void callHelper(uint8_t helperOffset, int valueReg) {
+        bytes({0x89, 0xC6});  // mov esi, eax
+        if (valueReg >= 0) bytes({0x8B, 0x53, static_cast<uint8_t>(valueReg * 4)});  // mov edx, [rbx + reg * 4]
+        bytes({0x48, 0x89, 0xEF});        // mov rdi, rbp
+        bytes({0xFF, 0x55, helperOffset});  // call [rbp + helper]
+    }
+
+    // test eax, eax
+    void testResult() { bytes({0x85, 0xC0}); }
+
+    // Short conditional jump with a displacement patched by bind
+    uint8_t* jumpIf(uint8_t condition) {
+        bytes({condition, 0x00});
+        return cursor;
+    }
+    void bind(uint8_t* jumpEnd) { jumpEnd[-1] = static_cast<uint8_t>(cursor - jumpEnd); }
+
+    // Returns eax as the next PC after recording the guest instruction count
+    void exitWithEax(uint32_t executed) {
+        bytes({0xC7, 0x45, kExecutedOffset});  // mov dword [rbp + executed], imm32
+        imm32(executed);
+        bytes({0x48, 0x83, 0xC4, 0x08});  // add rsp, 8
+        bytes({0x5B});                    // pop rbx
+        bytes({0x5D});                    // pop rbp
+        bytes({0xC3});                    // ret
+    }
+
+    void exit(uint32_t nextPC, uint32_t executed) {
+        movImm(nextPC);
+        exitWithEax(executed);
+    }
+
+   private:
+    void bytes(std::initializer_list<uint8_t> values) {
+        for (uint8_t value : values) *cursor++ = value;
+    }
+    void imm32(uint32_t value) {
+        std::memcpy(cursor, &value, sizeof(value));
+        cursor += sizeof(value);
+    }
+
+    uint8_t* cursor;
+};
+
+constexpr uint8_t kAddEax = 0x03;
+constexpr uint8_t kSubEax = 0x2B;
+constexpr uint8_t kAndEax = 0x23;
+constexpr uint8_t kOrEax = 0x0B;
+constexpr uint8_t kCmpEax = 0x3B;
+constexpr uint8_t kJz = 0x74;
+constexpr uint8_t kJne = 0x75;
+
+uint8_t aluOpcode(BlockOpKind kind) {
+    switch (kind) {
+        case BlockOpKind::Sub: return kSubEax;
+        case BlockOpKind::And: return kAndEax;
+        case BlockOpKind::Or: return kOrEax;
+        default: return kAddEax;
+    }
+}
+
+}  // namespace
+
+bool JitCompiler::available() {
+#ifdef MIPS_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+JitCompiler::JitCompiler(size_t bufferSize) : buffer(nullptr), bufferSize(bufferSize), used(0), compiled(0) {}
+
+JitCompiler::~JitCompiler() {
+#ifdef MIPS_JIT_X86_64
+    if (buffer != nullptr) munmap(buffer, bufferSize);
+#endif
+}
+
+void JitCompiler::reset() {
+    translations.clear();
+    heat.clear();
+    used = 0;
+    compiled = 0;
+}
+
+void JitCompiler::invalidate(uint32_t address, uint32_t size) {
+    for (auto it = translations.begin(); it != translations.end();) {
+        if (address < it->second.endPC + 4 && it->second.startPC < address + size) {
+            heat.erase(it->first);
+            it = translations.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+JitCompiler::Code JitCompiler::compile(const TranslatedBlock& block) {
+    const BlockOp& first = block.ops.front();
+    if (first.kind == BlockOpKind::ClearReg || first.kind == BlockOpKind::Syscall) {
+        translations[block.startPC] = Translation{nullptr, block.startPC, block.endPC};
+        return nullptr;
+    }
+
+#ifdef MIPS_JIT_X86_64
+    if (buffer == nullptr) {
+        void* memory = mmap(nullptr, bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            translations[block.startPC] = Translation{nullptr, block.startPC, block.endPC};
+            return nullptr;
+        }
+        buffer = static_cast<uint8_t*>(memory);
+    } else if (mprotect(buffer, bufferSize, PROT_READ | PROT_WRITE) != 0) {
+        // The buffer is never writable and executable at once: reopen it for writing
+        translations[block.startPC] = Translation{nullptr, block.startPC, block.endPC};
+        return nullptr;
+    }
+    if (bufferSize - used < kMaxBlockCodeSize) {
+        // Code buffer full: start over, keeping only the entry being compiled
+        translations.clear();
+        heat.clear();
+        used = 0;
+    }
+
+    uint8_t* start = buffer + used;
+    Emitter emit(start);
+    emit.prologue();
+
+    for (const BlockOp& op : block.ops) {
+        uint32_t executed = (op.pc - block.startPC) / 4 + 1;  // Guest instructions up to this one
+        switch (op.kind) {
+            case BlockOpKind::Add:
+            case BlockOpKind::Sub:
+            case BlockOpKind::And:
+            case BlockOpKind::Or:
+                emit.loadGuest(op.rs);
+                emit.aluGuest(aluOpcode(op.kind), op.rt);
+                emit.storeGuest(op.rd);
+                continue;
+            case BlockOpKind::Slt:
+                emit.loadGuest(op.rs);
+                emit.aluGuest(kCmpEax, op.rt);
+                emit.setLess();
+                emit.storeGuest(op.rd);
+                continue;
+            case BlockOpKind::AddImm:
+                emit.loadGuest(op.rs);
+                emit.addImm(op.imm);
+                emit.storeGuest(op.rd);
+                continue;
+            case BlockOpKind::Load:
+                emit.loadGuest(op.rs);
+                emit.addImm(op.imm);
+                emit.callHelper(kLoadOffset, -1);
+                emit.storeGuest(op.rd);
+                continue;
+            case BlockOpKind::Store: {
+                emit.loadGuest(op.rs);
+                emit.addImm(op.imm);
+                emit.callHelper(kStoreOffset, op.rt);
+                emit.testResult();
+                uint8_t* unchanged = emit.jumpIf(kJz);
+                emit.exit(op.pc + 4, executed);  // The text segment changed under us
+                emit.bind(unchanged);
+                continue;
+            }
+            case BlockOpKind::Beq: {
+                emit.loadGuest(op.rs);
+                emit.aluGuest(kCmpEax, op.rt);
+                uint8_t* notTaken = emit.jumpIf(kJne);
+                emit.exit(op.imm, executed);
+                emit.bind(notTaken);
+                emit.exit(op.pc + 4, executed);
+                break;
+            }
+            case BlockOpKind::J:
+            case BlockOpKind::Fallthrough:
+                emit.exit(op.imm, executed);
+                break;
+            case BlockOpKind::Jal:
+                emit.storeGuestImm(31, op.pc + 4);
+                emit.exit(op.imm, executed);
+                break;
+            case BlockOpKind::Jr:
+                emit.loadGuest(31);  // jr always returns through $ra
+                emit.exitWithEax(executed);
+                break;
+            case BlockOpKind::ClearReg:
+            case BlockOpKind::Syscall:
+                emit.exit(op.pc, executed - 1);  // Left to the interpreter
+                break;
+        }
+        break;
+    }
+
+    used += emit.position() - start;
+    if (mprotect(buffer, bufferSize, PROT_READ | PROT_EXEC) != 0) {
+        // Cannot run anything from the buffer; leave every block to the interpreter
+        translations.clear();
+        translations[block.startPC] = Translation{nullptr, block.startPC, block.endPC};
+        return nullptr;
+    }
+    compiled++;
+    Code code = reinterpret_cast<Code>(start);
+    translations[block.startPC] = Translation{code, block.startPC, block.endPC};
+    return code;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "block_cache.h"
+
+// Guest state shared with translated code. Field offsets are baked into the generated code.
+struct JitContext {
+    uint32_t* registers;  // Guest registers, read and written in place
+    uint32_t executed;    // Guest instructions run by the last call into translated code
+    uint32_t reserved;
+    void* owner;  // Passed back to the helpers
+    uint32_t (*load)(JitContext* context, uint32_t address);
+    // Returns nonzero when the store changed the text segment; translated code then exits
+    uint32_t (*store)(JitContext* context, uint32_t address, uint32_t value);
+};
+
+// x86-64 translator for hot basic blocks (Linux only).
+// Handles add/sub/and/or/slt/addi/lw/sw/beq/j/jal/jr; a block stops before a syscall or
+// any other operation so the interpreter can run it. The code buffer is writable only while
+// a block is being emitted and executable only in between.
+class JitCompiler {
+   public:
+    // Translated block entry point; returns the next guest PC
+    using Code = uint32_t (*)(JitContext* context);
+
+    static constexpr uint32_t kHotThreshold = 8;  // Block executions before translation
+
+    // True when this build can generate and run host code
+    static bool available();
+
+    explicit JitCompiler(size_t bufferSize = 1 << 20);
+    ~JitCompiler();
+
+    // Drops all translations and execution counts
+    void reset();
+
+    // Translated code for the block at pc, or nullptr while the block is cold or starts with
+    // an operation the translator does not handle
+    Code lookup(uint32_t pc, BlockCache& blocks) {
+        auto it = translations.find(pc);
+        if (it != translations.end()) return it->second.code;
+        if (++heat[pc] < kHotThreshold) return nullptr;
+        return compile(*blocks.lookup(pc));
+    }
+
+    // Drops translations covering [address, address + size)
+    void invalidate(uint32_t address, uint32_t size);
+
+    uint64_t compiledBlocks() const { return compiled; }
+
+   private:
+    struct Translation {
+        Code code;  // nullptr for blocks the translator rejected
+        uint32_t startPC;
+        uint32_t endPC;
+    };
+
+    Code compile(const TranslatedBlock& block);
+
+    uint8_t* buffer;
+    size_t bufferSize;
+    size_t used;
+    std::unordered_map<uint32_t, Translation> translations;
+    std::unordered_map<uint32_t, uint32_t> heat;
+    uint64_t compiled;
+};
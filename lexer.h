@@ -0,0 +1,75 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+
+// Splits a source buffer into trimmed lines without copying. Views stay valid as long as the buffer.
+class Lexer {
+   public:
+    explicit Lexer(std::string_view source) : source(source), position(0), lines(0) {}
+
+    // Next line with leading and trailing blanks removed; false at the end of the buffer
+    bool nextLine(std::string_view& line) {
+        if (position >= source.size()) return false;
+        size_t end = source.find('\n', position);
+        if (end == std::string_view::npos) end = source.size();
+        line = trim(source.substr(position, end - position));
+        position = end + 1;
+        lines++;
+        return true;
+    }
+
+    // 1-based number of the line last returned by nextLine
+    uint32_t lineNumber() const { return lines; }
+
+    static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    static std::string_view trim(std::string_view text) {
+        size_t begin = 0;
+        while (begin < text.size() && isBlank(text[begin])) begin++;
+        size_t end = text.size();
+        while (end > begin && isBlank(text[end - 1])) end--;
+        return text.substr(begin, end - begin);
+    }
+
+   private:
+    std::string_view source;
+    size_t position;
+    uint32_t lines;
+};
+
+// Splits one line into tokens. Blanks and commas separate tokens, so "a,b", "a, b" and
+// "a , b" all give two tokens; '#' starts a comment that runs to the end of the line.
+class LineTokenizer {
+   public:
+    explicit LineTokenizer(std::string_view line) : line(line), position(0) {}
+
+    // Next token; false when the line (or its code part) is exhausted
+    bool next(std::string_view& token) {
+        while (position < line.size() && isSeparator(line[position])) position++;
+        if (position >= line.size() || line[position] == '#') return false;
+        size_t begin = position;
+        while (position < line.size() && !isSeparator(line[position]) && line[position] != '#') position++;
+        token = line.substr(begin, position - begin);
+        return true;
+    }
+
+    // Text after the last token returned, with leading blanks removed
+    std::string_view rest() const { return Lexer::trim(line.substr(position)); }
+
+   private:
+    static bool isSeparator(char c) { return Lexer::isBlank(c) || c == ','; }
+
+    std::string_view line;
+    size_t position;
+};
+
+// Parses a decimal integer the way std::stoi does (optional sign, digits, trailing text ignored)
+inline bool parseInteger(std::string_view text, int& value) {
+    size_t begin = 0;
+    while (begin < text.size() && Lexer::isBlank(text[begin])) begin++;
+    if (begin < text.size() && text[begin] == '+') begin++;
+    const char* first = text.data() + begin;
+    const char* last = text.data() + text.size();
+    return std::from_chars(first, last, value).ec == std::errc();
+}
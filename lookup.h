@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "encode.h"
+
+// Name -> value pair used to build a PerfectHash
+template <typename Value>
+struct NamedValue {
+    std::string_view name;
+    Value value;
+};
+
+// Collision-free hash table built at compile time: a lookup is one hash and one compare
+template <typename Value, size_t Slots>
+struct PerfectHash {
+    static_assert((Slots & (Slots - 1)) == 0, "slot count must be a power of two");
+
+    uint32_t seed;  // 0 when no collision-free seed was found
+    std::array<std::string_view, Slots> names;
+    std::array<Value, Slots> values;
+
+    static constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+        uint32_t h = seed * 2166136261u;
+        for (char c : name) h = (h ^ static_cast<uint8_t>(c)) * 16777619u;  // FNV-1a
+        return (h ^ (h >> 15)) & (Slots - 1);
+    }
+
+    constexpr bool find(std::string_view name, Value& value) const {
+        uint32_t slot = hash(name, seed);
+        if (name.empty() || names[slot] != name) return false;  // Empty slots hold empty names
+        value = values[slot];
+        return true;
+    }
+};
+
+// Searches for a seed that maps every entry to its own slot
+template <typename Value, size_t Slots, typename Entries>
+constexpr PerfectHash<Value, Slots> makePerfectHash(const Entries& entries) {
+    for (uint32_t seed = 1; seed < 100000; seed++) {
+        PerfectHash<Value, Slots> table{};
+        table.seed = seed;
+        bool collisionFree = true;
+        for (const NamedValue<Value>& entry : entries) {
+            uint32_t slot = PerfectHash<Value, Slots>::hash(entry.name, seed);
+            if (!table.names[slot].empty()) {
+                collisionFree = false;
+                break;
+            }
+            table.names[slot] = entry.name;
+            table.values[slot] = entry.value;
+        }
+        if (collisionFree) return table;
+    }
+    return PerfectHash<Value, Slots>{};
+}
+
+// Mnemonics accepted in source (lui is only generated by expansions)
+constexpr NamedValue<Mnemonic> kMnemonicNames[] = {
+    {"add", Mnemonic::Add},    {"sub", Mnemonic::Sub},    {"mult", Mnemonic::Mult},  {"div", Mnemonic::Div},
+    {"mflo", Mnemonic::Mflo},  {"mfhi", Mnemonic::Mfhi},  {"and", Mnemonic::And},    {"or", Mnemonic::Or},
+    {"slt", Mnemonic::Slt},    {"move", Mnemonic::Move},  {"jr", Mnemonic::Jr},      {"syscall", Mnemonic::Syscall},
+    {"add.s", Mnemonic::AddS}, {"addi", Mnemonic::Addi},  {"li", Mnemonic::Li},      {"lw", Mnemonic::Lw},
+    {"sw", Mnemonic::Sw},      {"lwc1", Mnemonic::Lwc1},  {"swc1", Mnemonic::Swc1},  {"beq", Mnemonic::Beq},
+    {"j", Mnemonic::J},        {"jal", Mnemonic::Jal},    {"la", Mnemonic::La},
+};
+
+constexpr int kAssemblerTemporary = 1;  // $at, base register of expanded loads and stores
+
+// Conventional register names indexed by register number
+constexpr std::string_view kRegisterNames[32] = {
+    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3", "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+    "$s0",   "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7", "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra",
+};
+
+constexpr std::array<NamedValue<uint8_t>, 32> registerEntries() {
+    std::array<NamedValue<uint8_t>, 32> entries{};
+    for (uint8_t i = 0; i < 32; i++) entries[i] = {kRegisterNames[i], i};
+    return entries;
+}
+
+constexpr std::array<NamedValue<uint8_t>, 32> kRegisterEntries = registerEntries();
+
+constexpr auto kMnemonicTable = makePerfectHash<Mnemonic, 64>(kMnemonicNames);
+constexpr auto kRegisterTable = makePerfectHash<uint8_t, 128>(kRegisterEntries);
+
+static_assert(kMnemonicTable.seed != 0, "no collision-free seed for the mnemonic table");
+static_assert(kRegisterTable.seed != 0, "no collision-free seed for the register table");
+
+inline bool lookupMnemonic(std::string_view name, Mnemonic& mnemonic) { return kMnemonicTable.find(name, mnemonic); }
+
+// Register number for "$name" or "$n" (0-31)
+inline bool lookupRegister(std::string_view name, int& number) {
+    if (name.size() >= 2 && name.size() <= 3 && name[0] == '$' && name[1] >= '0' && name[1] <= '9') {
+        number = name[1] - '0';
+        if (name.size() == 3) {
+            if (name[1] == '0' || name[2] < '0' || name[2] > '9') return false;
+            number = number * 10 + (name[2] - '0');
+        }
+        return number < 32;
+    }
+    uint8_t value;
+    if (!kRegisterTable.find(name, value)) return false;
+    number = value;
+    return true;
+}
+
+// Compile-time register lookup, 0xFF for unknown names
+constexpr int registerNumber(std::string_view name) {
+    uint8_t value = 0xFF;
+    kRegisterTable.find(name, value);
+    return value;
+}
+
+static_assert(registerNumber("$zero") == 0 && registerNumber("$t0") == 8 && registerNumber("$ra") == 31, "register table");
@@ -0,0 +1,135 @@
+#include "memory.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Pages carved from one pool chunk. A chunk this large is served by fresh zero-filled
+// mappings, so only the pages actually written become resident.
+constexpr size_t kSlabPages = 64;
+
+}  // namespace
+
+PagedMemory::PagedMemory() : slabPagesLeft(0) {
+    table = static_cast<uint8_t**>(std::calloc(kPageCount, sizeof(uint8_t*)));
+    if (table == nullptr) throw std::bad_alloc();
+}
+
+PagedMemory::~PagedMemory() {
+    for (uint8_t* slab : slabs) std::free(slab);
+    std::free(table);
+}
+
+uint8_t* PagedMemory::allocatePage(uint32_t index) {
+    if (slabPagesLeft == 0) {
+        uint8_t* slab = static_cast<uint8_t*>(std::calloc(kSlabPages, kPageSize));
+        if (slab == nullptr) throw std::bad_alloc();
+        slabs.push_back(slab);
+        slabPagesLeft = kSlabPages;
+    }
+    uint8_t* page = slabs.back() + (kSlabPages - slabPagesLeft) * kPageSize;
+    slabPagesLeft--;
+    table[index] = page;
+    allocatedPages.push_back(index);
+    return page;
+}
+
+uint32_t PagedMemory::readWordSlow(uint32_t address) const {
+    return static_cast<uint32_t>(readByte(address)) |
+           (static_cast<uint32_t>(readByte(address + 1)) << 8) |
+           (static_cast<uint32_t>(readByte(address + 2)) << 16) |
+           (static_cast<uint32_t>(readByte(address + 3)) << 24);
+}
+
+void PagedMemory::writeWordSlow(uint32_t address, uint32_t value) {
+    writeByte(address, value & 0xFF);
+    writeByte(address + 1, (value >> 8) & 0xFF);
+    writeByte(address + 2, (value >> 16) & 0xFF);
+    writeByte(address + 3, (value >> 24) & 0xFF);
+}
+
+void PagedMemory::readBytes(uint32_t address, uint8_t* destination, size_t size) const {
+    while (size > 0) {
+        size_t chunk = std::min<size_t>(size, kPageSize - (address & kPageMask));
+        const uint8_t* page = table[address >> kPageBits];
+        if (page != nullptr) {
+            std::memcpy(destination, page + (address & kPageMask), chunk);
+        } else {
+            std::memset(destination, 0, chunk);
+        }
+        address += static_cast<uint32_t>(chunk);
+        destination += chunk;
+        size -= chunk;
+    }
+}
+
+void PagedMemory::writeBytes(uint32_t address, const uint8_t* source, size_t size) {
+    while (size > 0) {
+        size_t chunk = std::min<size_t>(size, kPageSize - (address & kPageMask));
+        std::memcpy(writablePage(address) + (address & kPageMask), source, chunk);
+        address += static_cast<uint32_t>(chunk);
+        source += chunk;
+        size -= chunk;
+    }
+}
+
+bool PagedMemory::firstDifference(const PagedMemory& other, uint32_t& address) const {
+    // Only pages allocated on either side can differ; absent pages read as zeros
+    std::vector<uint32_t> pages(allocatedPages);
+    pages.insert(pages.end(), other.allocatedPages.begin(), other.allocatedPages.end());
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+    static const uint8_t zeroPage[kPageSize] = {};
+    for (uint32_t index : pages) {
+        const uint8_t* mine = table[index] != nullptr ? table[index] : zeroPage;
+        const uint8_t* theirs = other.table[index] != nullptr ? other.table[index] : zeroPage;
+        if (std::memcmp(mine, theirs, kPageSize) == 0) continue;
+        uint32_t offset = 0;
+        while (mine[offset] == theirs[offset]) offset++;
+        address = (index << kPageBits) | offset;
+        return true;
+    }
+    return false;
+}
+
+void PagedMemory::clear() {
+    for (uint32_t index : allocatedPages) table[index] = nullptr;
+    allocatedPages.clear();
+    for (uint8_t* slab : slabs) std::free(slab);
+    slabs.clear();
+    slabPagesLeft = 0;
+}
+
+CodePageMap::CodePageMap() {
+    regions = static_cast<uint64_t**>(std::calloc(kRegionCount, sizeof(uint64_t*)));
+    if (regions == nullptr) throw std::bad_alloc();
+}
+
+CodePageMap::~CodePageMap() {
+    for (uint32_t index : allocatedRegions) std::free(regions[index]);
+    std::free(regions);
+}
+
+void CodePageMap::mark(uint32_t first, uint32_t last) {
+    for (uint32_t page = first >> kPageBits; page <= last >> kPageBits; page++) {
+        uint32_t region = page >> (kRegionBits - kPageBits);
+        if (regions[region] == nullptr) {
+            regions[region] = static_cast<uint64_t*>(std::calloc(kRegionWords, sizeof(uint64_t)));
+            if (regions[region] == nullptr) throw std::bad_alloc();
+            allocatedRegions.push_back(region);
+        }
+        uint32_t bit = page & ((1u << (kRegionBits - kPageBits)) - 1);
+        regions[region][bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+void CodePageMap::clear() {
+    for (uint32_t index : allocatedRegions) {
+        std::free(regions[index]);
+        regions[index] = nullptr;
+    }
+    allocatedRegions.clear();
+}
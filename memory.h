@@ -0,0 +1,123 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Reverses the byte order of a word (instruction words are stored most significant byte first)
+inline uint32_t byteSwap(uint32_t value) {
+    return (value >> 24) | ((value >> 8) & 0x0000FF00) | ((value << 8) & 0x00FF0000) | (value << 24);
+}
+
+// Sparse guest memory covering the whole 32-bit address space. 4 KB pages are allocated on
+// first write from a pool; reads of untouched memory return 0 without allocating. Words are
+// stored least significant byte first.
+class PagedMemory {
+   public:
+    static constexpr uint32_t kPageBits = 12;
+    static constexpr uint32_t kPageSize = 1u << kPageBits;
+    static constexpr uint32_t kPageMask = kPageSize - 1;
+    static constexpr size_t kPageCount = size_t(1) << (32 - kPageBits);
+
+    PagedMemory();
+    ~PagedMemory();
+    PagedMemory(const PagedMemory&) = delete;
+    PagedMemory& operator=(const PagedMemory&) = delete;
+
+    uint8_t readByte(uint32_t address) const {
+        const uint8_t* page = table[address >> kPageBits];
+        return page != nullptr ? page[address & kPageMask] : 0;
+    }
+
+    void writeByte(uint32_t address, uint8_t value) { writablePage(address)[address & kPageMask] = value; }
+
+    // Little-endian word; words inside one page take the fast path
+    uint32_t readWord(uint32_t address) const {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        uint32_t offset = address & kPageMask;
+        if (offset <= kPageSize - 4) {
+            const uint8_t* page = table[address >> kPageBits];
+            if (page == nullptr) return 0;
+            uint32_t value;
+            std::memcpy(&value, page + offset, sizeof(value));
+            return value;
+        }
+#endif
+        return readWordSlow(address);
+    }
+
+    void writeWord(uint32_t address, uint32_t value) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        uint32_t offset = address & kPageMask;
+        if (offset <= kPageSize - 4) {
+            std::memcpy(writablePage(address) + offset, &value, sizeof(value));
+            return;
+        }
+#endif
+        writeWordSlow(address, value);
+    }
+
+    void readBytes(uint32_t address, uint8_t* destination, size_t size) const;
+    void writeBytes(uint32_t address, const uint8_t* source, size_t size);
+
+    // Finds the lowest address where the two memories differ; false if they are identical
+    bool firstDifference(const PagedMemory& other, uint32_t& address) const;
+
+    // Drops every page
+    void clear();
+
+    size_t pagesAllocated() const { return allocatedPages.size(); }
+
+   private:
+    uint8_t* writablePage(uint32_t address) {
+        uint8_t* page = table[address >> kPageBits];
+        return page != nullptr ? page : allocatePage(address >> kPageBits);
+    }
+
+    uint8_t* allocatePage(uint32_t index);
+    uint32_t readWordSlow(uint32_t address) const;
+    void writeWordSlow(uint32_t address, uint32_t value);
+
+    uint8_t** table;                       // Flat first-level table of kPageCount entries
+    std::vector<uint32_t> allocatedPages;  // Indexes of the pages in use
+    std::vector<uint8_t*> slabs;           // Pool chunks pages are carved from
+    size_t slabPagesLeft;                  // Unused pages in the newest slab
+};
+
+// Marks the regions of guest memory that instructions have been fetched or translated from,
+// so stores can tell whether they may overwrite code. Pages here are 256 bytes rather than
+// the 4 KB of PagedMemory: .data starts at 0 and .text at 0x100, and with 4 KB pages every
+// data store would look like a store into code. Like PagedMemory the map has two levels:
+// a flat table of 1 MB regions whose page bitmaps are allocated when a page in them is marked.
+class CodePageMap {
+   public:
+    static constexpr uint32_t kPageBits = 8;
+    static constexpr uint32_t kRegionBits = 20;
+    static constexpr size_t kRegionCount = size_t(1) << (32 - kRegionBits);
+
+    CodePageMap();
+    ~CodePageMap();
+    CodePageMap(const CodePageMap&) = delete;
+    CodePageMap& operator=(const CodePageMap&) = delete;
+
+    bool contains(uint32_t address) const {
+        const uint64_t* bits = regions[address >> kRegionBits];
+        if (bits == nullptr) return false;  // No code anywhere in the region
+        uint32_t page = (address & kRegionMask) >> kPageBits;
+        return (bits[page / 64] >> (page % 64)) & 1;
+    }
+
+    // Marks every page overlapping [first, last]
+    void mark(uint32_t first, uint32_t last);
+
+    // Unmarks every page
+    void clear();
+
+   private:
+    static constexpr uint32_t kRegionMask = (1u << kRegionBits) - 1;
+    static constexpr size_t kRegionWords = (size_t(1) << (kRegionBits - kPageBits)) / 64;
+
+    uint64_t** regions;                     // Flat first-level table of kRegionCount entries
+    std::vector<uint32_t> allocatedRegions;  // Indexes of the regions with a bitmap
+};
@@ -0,0 +1,239 @@
+#include "ooo.h"
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+
+bool parseOutOfOrderConfig(const std::string& text, OutOfOrderConfig& config) {
+    OutOfOrderConfig parsed = config;
+    size_t position = 0;
+    size_t fields = 0;
+    for (uint32_t* field : {&parsed.width, &parsed.robSize, &parsed.stations, &parsed.aluLatency, &parsed.multiplyLatency,
+                            &parsed.divideLatency}) {
+        if (position > text.size()) break;
+        size_t end = std::min(text.find(':', position), text.size());
+        auto [stop, error] = std::from_chars(text.data() + position, text.data() + end, *field);
+        if (error != std::errc() || stop != text.data() + end) return false;
+        position = end + 1;
+        fields++;
+    }
+    if (position <= text.size() || fields < 3) return false;  // Trailing or missing fields
+    if (parsed.width == 0 || parsed.robSize == 0 || parsed.stations == 0) return false;
+    if (parsed.aluLatency == 0 || parsed.multiplyLatency == 0 || parsed.divideLatency == 0) return false;
+    config = parsed;
+    return true;
+}
+
+const char* outOfOrderStallName(OutOfOrderStall stall) {
+    switch (stall) {
+        case OutOfOrderStall::InstructionCache:
+            return "instruction cache";
+        case OutOfOrderStall::Mispredict:
+            return "mispredictions";
+        case OutOfOrderStall::RobFull:
+            return "ROB full";
+        case OutOfOrderStall::StationsFull:
+            return "stations full";
+        case OutOfOrderStall::UnitsBusy:
+            return "unit waits";
+        case OutOfOrderStall::Count:
+            break;
+    }
+    return "unknown";
+}
+
+OutOfOrderModel::OutOfOrderModel(const OutOfOrderConfig& core) : config(core) { reset(); }
+
+void OutOfOrderModel::reset() {
+    hasNext = false;
+    fetchCycle = dispatchCycle = commitCycle = 0;
+    fetched = dispatched = committed = 0;
+    lastMemory = 0;
+    robCommits.assign(config.robSize, 0);
+    stationIssues = {};
+    for (Unit unit : {Alu, Branch, Memory, Multiply}) {
+        unitCount[unit] = unit == Alu ? config.width : 1;
+        calendarCycle[unit].assign(kCalendarCycles, 0);
+        calendarUsed[unit].assign(kCalendarCycles, 0);
+    }
+    dividerFree = 0;
+    std::fill(std::begin(registerReady), std::end(registerReady), 0);
+    lastCommit = 0;
+    count = 0;
+    std::fill(std::begin(stalls), std::end(stalls), 0);
+}
+
+void OutOfOrderModel::fetch(const DecodedInstruction& decoded, uint32_t pc, uint32_t fetchStall) {
+    if (hasNext) schedule(pc != next.pc + 4);
+    Instruction instruction{};
+    instruction.unit = Alu;
+    instruction.pc = pc;
+    instruction.fetchStall = fetchStall;
+    switch (decoded.op) {
+        case Op::Lw:
+            instruction.unit = Memory;
+            instruction.load = true;
+            instruction.dest = decoded.rd;
+            instruction.sources[0] = decoded.rs;
+            break;
+        case Op::Sw:
+            instruction.unit = Memory;
+            instruction.sources[0] = decoded.rs;
+            instruction.sources[1] = decoded.rt;
+            break;
+        case Op::Addi:
+            instruction.dest = decoded.rd;
+            instruction.sources[0] = decoded.rs;
+            break;
+        case Op::Beq:
+            instruction.unit = Branch;
+            instruction.sources[0] = decoded.rs;
+            instruction.sources[1] = decoded.rt;
+            break;
+        case Op::J:
+            instruction.unit = Branch;
+            break;
+        case Op::Jal:
+            instruction.unit = Branch;
+            instruction.dest = 31;
+            break;
+        case Op::Jr:
+            instruction.unit = Branch;
+            instruction.sources[0] = 31;  // jr always returns through $ra
+            break;
+        case Op::Syscall:
+            instruction.sources[0] = 2;  // $v0 selects the service
+            instruction.sources[1] = 4;  // $a0 is its argument
+            break;
+        case Op::Nop:
+            break;
+        case Op::Mult:
+        case Op::Mfhi:
+        case Op::Mflo:
+            instruction.unit = Multiply;
+            instruction.dest = decoded.rd;
+            instruction.sources[0] = decoded.rs;
+            instruction.sources[1] = decoded.rt;
+            break;
+        case Op::Div:
+            instruction.unit = Divide;
+            instruction.dest = decoded.rd;
+            instruction.sources[0] = decoded.rs;
+            instruction.sources[1] = decoded.rt;
+            break;
+        default:  // Remaining R-type ALU operations write rd
+            instruction.dest = decoded.rd;
+            instruction.sources[0] = decoded.rs;
+            instruction.sources[1] = decoded.rt;
+            break;
+    }
+    next = instruction;
+    hasNext = true;
+}
+
+void OutOfOrderModel::drain() {
+    if (hasNext) schedule(false);
+    hasNext = false;
+}
+
+uint64_t OutOfOrderModel::claimSlot(uint64_t earliest, uint64_t& cycle, uint32_t& used) const {
+    if (earliest > cycle) {
+        cycle = earliest;
+        used = 0;
+    }
+    if (used == config.width) {
+        cycle++;
+        used = 0;
+    }
+    used++;
+    return cycle;
+}
+
+// First cycle from earliest with an idle unit of kind, which is then taken for that cycle.
+// Later instructions may take an earlier cycle than their predecessors got.
+uint64_t OutOfOrderModel::claimUnit(Unit unit, uint64_t earliest) {
+    for (uint64_t cycle = earliest;; cycle++) {
+        size_t slot = cycle & (kCalendarCycles - 1);
+        if (calendarCycle[unit][slot] < cycle) {
+            calendarCycle[unit][slot] = cycle;  // Stale entry of an earlier cycle
+            calendarUsed[unit][slot] = 0;
+        }
+        if (calendarCycle[unit][slot] == cycle && calendarUsed[unit][slot] < unitCount[unit]) {
+            calendarUsed[unit][slot]++;
+            return cycle;
+        }
+    }
+}
+
+// Places next in every stage, in program order for fetch, dispatch and commit
+void OutOfOrderModel::schedule(bool redirect) {
+    const Instruction& instruction = next;
+
+    // Front end: width instructions per cycle, after the instruction cache delivers the line
+    if (instruction.fetchStall > 0) {
+        stalls[static_cast<size_t>(OutOfOrderStall::InstructionCache)] += instruction.fetchStall;
+        fetchCycle += instruction.fetchStall + (fetched > 0 ? 1 : 0);
+        fetched = 0;
+    }
+    uint64_t fetchedAt = claimSlot(fetchCycle, fetchCycle, fetched);
+
+    // Dispatch, one cycle after fetch, into a ROB entry and a reservation station. Stall
+    // cycles count how far each structure pushes the in-order dispatch point.
+    uint64_t dispatch = std::max(fetchedAt + 1, dispatchCycle);
+    uint64_t& robEntry = robCommits[count % config.robSize];  // Held by the instruction robSize back
+    if (robEntry >= dispatch) {
+        stalls[static_cast<size_t>(OutOfOrderStall::RobFull)] += robEntry + 1 - dispatch;
+        dispatch = robEntry + 1;
+    }
+    while (!stationIssues.empty() && stationIssues.top() <= dispatch) stationIssues.pop();
+    if (stationIssues.size() == config.stations) {
+        stalls[static_cast<size_t>(OutOfOrderStall::StationsFull)] += stationIssues.top() - dispatch;
+        dispatch = stationIssues.top();
+        stationIssues.pop();
+    }
+    dispatch = claimSlot(dispatch, dispatchCycle, dispatched);
+    if (dispatch > fetchCycle + 1) {
+        // The front end holds what it fetched until dispatch drains it
+        fetchCycle = dispatch - 1;
+        fetched = 0;
+    }
+
+    // Issue once the operands are ready and a unit is free
+    uint64_t operands = dispatch + 1;
+    for (uint8_t source : instruction.sources) {
+        if (source != 0) operands = std::max(operands, registerReady[source]);
+    }
+    if (instruction.unit == Memory) operands = std::max(operands, lastMemory + 1);  // Memory operations stay in order
+    uint32_t latency = config.aluLatency;
+    uint64_t issue;
+    if (instruction.unit == Divide) {
+        latency = config.divideLatency;
+        issue = std::max(operands, dividerFree);
+        dividerFree = issue + latency;
+    } else {
+        if (instruction.unit == Memory) latency = 1 + instruction.memoryStall;
+        if (instruction.unit == Multiply) latency = config.multiplyLatency;
+        issue = claimUnit(instruction.unit, operands);
+    }
+    if (instruction.unit == Memory) lastMemory = issue;
+    stalls[static_cast<size_t>(OutOfOrderStall::UnitsBusy)] += issue - operands;
+    stationIssues.push(issue);
+    uint64_t complete = issue + latency;
+    if (instruction.dest != 0) registerReady[instruction.dest] = complete;
+
+    // Commit in order once complete
+    uint64_t commit = claimSlot(complete, commitCycle, committed);
+    robEntry = commit;
+    lastCommit = commit;
+    count++;
+
+    // A mispredicted transfer restarts fetch once it resolves; a taken one ends the fetch group
+    bool mispredicted = instruction.predicted ? instruction.mispredicted : redirect;
+    if (mispredicted && complete + 1 > fetchCycle) {
+        stalls[static_cast<size_t>(OutOfOrderStall::Mispredict)] += complete + 1 - fetchCycle;
+        fetchCycle = complete + 1;
+        fetched = 0;
+    } else if (redirect) {
+        fetched = config.width;
+    }
+}
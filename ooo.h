@@ -0,0 +1,115 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "decode.h"
+
+// Core width, window sizes and functional unit latencies in cycles
+struct OutOfOrderConfig {
+    uint32_t width;            // Instructions fetched, dispatched and committed per cycle
+    uint32_t robSize;          // Reorder buffer entries
+    uint32_t stations;         // Reservation station entries, shared by all units
+    uint32_t aluLatency;       // add, sub, and, or, slt, addi and branches
+    uint32_t multiplyLatency;  // Pipelined multiplier
+    uint32_t divideLatency;    // Divider, busy for the whole division
+};
+
+constexpr OutOfOrderConfig kDefaultOutOfOrderConfig = {4, 64, 32, 1, 4, 20};
+
+// Parses "width:rob:stations[:alu:multiply:divide]". Omitted fields keep their value in config.
+bool parseOutOfOrderConfig(const std::string& text, OutOfOrderConfig& config);
+
+// What held an instruction back on its way through the core
+enum class OutOfOrderStall : uint8_t {
+    InstructionCache,  // Fetch waiting on the instruction cache
+    Mispredict,        // Fetch restarting after a mispredicted control transfer
+    RobFull,           // Dispatch waiting for the oldest instruction to commit
+    StationsFull,      // Dispatch waiting for a reservation station to issue
+    UnitsBusy,         // Ready instructions waiting for a functional unit, summed over instructions
+    Count,
+};
+
+const char* outOfOrderStallName(OutOfOrderStall stall);
+
+// Timing model of an out-of-order superscalar core with a reorder buffer and reservation
+// stations. The functional executor pushes each instruction in program order, like for the
+// PipelineModel; the model computes when it is fetched, dispatched, issued, completed and
+// committed from its register dependences and the occupancy of the ROB, the stations and the
+// functional units, without simulating values. Each cycle may fetch, dispatch and commit
+// width instructions and issue to width ALUs, one branch unit, one memory port, one
+// multiplier and one divider. Loads and stores are not reordered against each other.
+class OutOfOrderModel {
+   public:
+    explicit OutOfOrderModel(const OutOfOrderConfig& config = kDefaultOutOfOrderConfig);
+
+    // Starts a new run with an empty core
+    void reset();
+
+    // Records that decoded was fetched from pc, fetchStall cycles beyond one. The previous
+    // instruction is scheduled now that its successor is known.
+    void fetch(const DecodedInstruction& decoded, uint32_t pc, uint32_t fetchStall);
+
+    // Overrides the not-taken guess for the instruction last fetched: whether a predictor
+    // fetched its successor
+    void predicted(bool correct) {
+        next.predicted = true;
+        next.mispredicted = !correct;
+    }
+
+    // Adds cycles the instruction last fetched spends on the data cache beyond one
+    void addMemoryStall(uint32_t cycles) { next.memoryStall += cycles; }
+
+    // Schedules the last instruction
+    void drain();
+
+    uint64_t cycles() const { return lastCommit; }
+    uint64_t instructions() const { return count; }
+    uint64_t stallCycles(OutOfOrderStall stall) const { return stalls[static_cast<size_t>(stall)]; }
+    const OutOfOrderConfig& configuration() const { return config; }
+
+   private:
+    enum Unit { Alu, Branch, Memory, Multiply, Divide, kUnits };
+
+    // Cycles of issue bookkeeping kept per pipelined unit kind; issues are never further
+    // apart than the window allows
+    static constexpr size_t kCalendarCycles = 8192;
+
+    // Instruction fetched but not yet scheduled
+    struct Instruction {
+        Unit unit;
+        bool load;
+        bool predicted;     // mispredicted comes from a branch predictor
+        bool mispredicted;
+        uint8_t dest;        // Register written, 0 for none
+        uint8_t sources[2];  // Registers read, 0 for none
+        uint32_t pc;
+        uint32_t fetchStall;
+        uint32_t memoryStall;
+    };
+
+    // Cycle at or after earliest with a free slot in a stage of width slots per cycle
+    uint64_t claimSlot(uint64_t earliest, uint64_t& cycle, uint32_t& used) const;
+    uint64_t claimUnit(Unit unit, uint64_t earliest);
+    void schedule(bool redirect);
+
+    OutOfOrderConfig config;
+    Instruction next;
+    bool hasNext;
+    uint64_t fetchCycle, dispatchCycle, commitCycle;  // Latest cycle of each in-order stage
+    uint32_t fetched, dispatched, committed;           // Slots used in that cycle
+    uint64_t lastMemory;                               // Issue cycle of the last load or store
+    std::vector<uint64_t> robCommits;                  // Commit cycle of the last robSize instructions
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> stationIssues;  // Issue cycles of occupied stations
+    uint32_t unitCount[kUnits];                        // Pipelined units of each kind
+    std::vector<uint64_t> calendarCycle[kUnits];       // Per kind, ring by cycle: the cycle of the entry
+    std::vector<uint32_t> calendarUsed[kUnits];        // and the units issued to in it
+    uint64_t dividerFree;                              // First cycle the divider accepts a division
+    uint64_t registerReady[32];                        // Cycle each register's latest value is available
+    uint64_t lastCommit;
+    uint64_t count;
+    uint64_t stalls[static_cast<size_t>(OutOfOrderStall::Count)];
+};
@@ -0,0 +1,186 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// No instruction depends on a write to $zero
+constexpr uint8_t kNoRegister = 0;
+
+}  // namespace
+
+const char* stallCauseName(StallCause cause) {
+    switch (cause) {
+        case StallCause::Fill:
+            return "fill/drain";
+        case StallCause::LoadUse:
+            return "load-use";
+        case StallCause::DataHazard:
+            return "data hazard";
+        case StallCause::Control:
+            return "control";
+        case StallCause::InstructionCache:
+            return "instruction cache";
+        case StallCause::DataCache:
+            return "data cache";
+        case StallCause::Count:
+            break;
+    }
+    return "unknown";
+}
+
+PipelineModel::PipelineModel(bool forwarding) : forward(forwarding) { reset(); }
+
+void PipelineModel::reset() {
+    std::fill(std::begin(stages), std::end(stages), bubble(StallCause::Fill));
+    hasNext = false;
+    issuing = false;
+    controlLeft = 0;
+    clock = 0;
+    retired = 0;
+    std::fill(std::begin(stalls), std::end(stalls), 0);
+}
+
+PipelineModel::Slot PipelineModel::bubble(StallCause cause) {
+    Slot slot{};
+    slot.cause = cause;
+    return slot;
+}
+
+void PipelineModel::fetch(const DecodedInstruction& decoded, uint32_t pc, uint32_t fetchStall) {
+    if (hasNext) issue(pc != nextPC + 4);
+    Slot slot{};
+    slot.valid = true;
+    slot.stall = fetchStall;
+    switch (decoded.op) {
+        case Op::Lw:
+            slot.load = true;
+            slot.dest = decoded.rd;
+            slot.sources[0] = decoded.rs;
+            break;
+        case Op::Sw:
+            slot.sources[0] = decoded.rs;
+            slot.sources[1] = decoded.rt;
+            break;
+        case Op::Addi:
+            slot.dest = decoded.rd;
+            slot.sources[0] = decoded.rs;
+            break;
+        case Op::Beq:
+            slot.sources[0] = decoded.rs;
+            slot.sources[1] = decoded.rt;
+            break;
+        case Op::Jal:
+            slot.dest = 31;
+            break;
+        case Op::Jr:
+            slot.sources[0] = 31;  // jr always returns through $ra
+            break;
+        case Op::Syscall:
+            slot.sources[0] = 2;  // $v0 selects the service
+            slot.sources[1] = 4;  // $a0 is its argument
+            break;
+        case Op::J:
+        case Op::Nop:
+            break;
+        default:  // R-type ALU operations, supported or not, write rd
+            slot.dest = decoded.rd;
+            slot.sources[0] = decoded.rs;
+            slot.sources[1] = decoded.rt;
+            break;
+    }
+    slot.redirectDelay = mispredictPenalty(decoded.op);  // Charged only if fetch redirects
+    next = slot;
+    nextPC = pc;
+    hasNext = true;
+}
+
+// Clocks the pipeline until next has been fetched into IF
+void PipelineModel::issue(bool redirect) {
+    if (!redirect && !next.predicted) next.redirectDelay = 0;
+    hasNext = false;
+    issuing = true;
+    while (issuing) step();
+}
+
+void PipelineModel::drain() {
+    if (hasNext) issue(false);
+    while (std::any_of(stages, stages + WB, [](const Slot& slot) { return slot.valid; })) step();
+}
+
+// Fills the IF stage: a bubble while a redirect is pending, else the next instruction
+PipelineModel::Slot PipelineModel::fetchSlot() {
+    if (controlLeft > 0) {
+        controlLeft--;
+        return bubble(StallCause::Control);
+    }
+    if (!issuing) return bubble(StallCause::Fill);
+    issuing = false;
+    controlLeft = next.redirectDelay;
+    return next;
+}
+
+// Why the instruction in ID cannot move to EX this cycle, or Count if it can
+StallCause PipelineModel::hazard() const {
+    const Slot& consumer = stages[ID];
+    if (!consumer.valid) return StallCause::Count;
+    for (uint8_t source : consumer.sources) {
+        if (source == kNoRegister) continue;
+        const Slot& ex = stages[EX];
+        if (forward) {
+            // Only a load's result arrives too late to be forwarded into the next EX
+            if (ex.valid && ex.load && ex.dest == source) return StallCause::LoadUse;
+            continue;
+        }
+        // Registers are written in the first half of WB and read in the second half of ID
+        for (const Slot* producer : {&stages[EX], &stages[MEM]}) {
+            if (producer->valid && producer->dest == source) {
+                return producer->load ? StallCause::LoadUse : StallCause::DataHazard;
+            }
+        }
+    }
+    return StallCause::Count;
+}
+
+// One clock: every stage that can advances into the next, and whatever reaches WB retires
+void PipelineModel::step() {
+    clock++;
+    advance();
+    const Slot& done = stages[WB];
+    if (done.valid) {
+        retired++;
+    } else {
+        stalls[static_cast<size_t>(done.cause)]++;
+    }
+}
+
+void PipelineModel::advance() {
+    Slot& memory = stages[MEM];
+    if (memory.valid && memory.stall > 0) {
+        // Waiting on the data cache freezes MEM and everything behind it
+        memory.stall--;
+        stages[WB] = bubble(StallCause::DataCache);
+        if (stages[IF].valid && stages[IF].stall > 0) stages[IF].stall--;
+        return;
+    }
+    stages[WB] = memory;
+    memory = stages[EX];
+    memory.stall = memory.memoryStall;
+
+    StallCause blocked = hazard();
+    if (blocked != StallCause::Count) {
+        // ID holds; a bubble goes down the pipeline in its place
+        stages[EX] = bubble(blocked);
+        if (stages[IF].valid && stages[IF].stall > 0) stages[IF].stall--;
+        return;
+    }
+    stages[EX] = stages[ID];
+    if (stages[IF].valid && stages[IF].stall > 0) {
+        stages[IF].stall--;
+        stages[ID] = bubble(StallCause::InstructionCache);
+        return;
+    }
+    stages[ID] = stages[IF];
+    stages[IF] = fetchSlot();
+}
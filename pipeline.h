@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "branch.h"
+#include "decode.h"
+
+// Why a pipeline slot holds no instruction
+enum class StallCause : uint8_t {
+    Fill,              // Pipeline filling at the start or draining at the end
+    LoadUse,           // Operand produced by a load still in flight
+    DataHazard,        // Operand produced by an ALU instruction, waiting for write-back
+    Control,           // Fetch slots lost to a taken branch or jump
+    InstructionCache,  // Fetch waiting on the instruction cache
+    DataCache,         // Load or store waiting on the data cache
+    Count,
+};
+
+const char* stallCauseName(StallCause cause);
+
+// Timing model of the classic IF/ID/EX/MEM/WB pipeline, driven by the functional executor:
+// each executed instruction is pushed in program order and flows through the stage
+// registers one clock at a time. Branches are predicted not taken unless a branch predictor
+// reports its outcome. j and jal redirect fetch from ID; beq and jr resolve in EX.
+// Wrong-path fetches are modelled as Control bubbles.
+class PipelineModel {
+   public:
+    // With forwarding, EX/MEM and MEM/WB results bypass to EX and only a load followed by
+    // a consumer stalls. Without it, operands are read in ID once the producer is in WB.
+    explicit PipelineModel(bool forwarding = true);
+
+    // Starts a new run with empty stages
+    void reset();
+
+    // Records that decoded was fetched from pc, fetchStall cycles beyond one. The previous
+    // instruction enters the pipeline now that its successor, and so whether it redirected
+    // fetch, is known.
+    void fetch(const DecodedInstruction& decoded, uint32_t pc, uint32_t fetchStall);
+
+    // Overrides the not-taken guess for the instruction last fetched: whether a predictor
+    // fetched its successor
+    void predicted(bool correct) {
+        next.predicted = true;
+        if (correct) next.redirectDelay = 0;
+    }
+
+    // Adds cycles the instruction last fetched spends in MEM beyond one
+    void addMemoryStall(uint32_t cycles) { next.memoryStall += cycles; }
+
+    // Issues the last instruction and clocks the pipeline until it has been written back
+    void drain();
+
+    uint64_t cycles() const { return clock; }
+    uint64_t instructions() const { return retired; }
+    uint64_t stallCycles(StallCause cause) const { return stalls[static_cast<size_t>(cause)]; }
+    bool forwarding() const { return forward; }
+
+   private:
+    // Contents of one stage: an instruction, or a bubble with the reason it is empty
+    struct Slot {
+        bool valid;
+        StallCause cause;
+        bool load;
+        bool predicted;          // redirectDelay comes from a branch predictor
+        uint8_t dest;            // Register written, 0 for none
+        uint8_t sources[2];      // Registers read, 0 for none
+        uint8_t redirectDelay;   // Control bubbles that follow a redirecting instruction
+        uint32_t stall;          // Extra cycles left in the current stage
+        uint32_t memoryStall;    // Extra cycles the instruction will spend in MEM
+    };
+
+    enum Stage { IF, ID, EX, MEM, WB, kStages };
+
+    static Slot bubble(StallCause cause);
+    void issue(bool redirect);
+    Slot fetchSlot();
+    StallCause hazard() const;
+    void step();
+    void advance();
+
+    bool forward;
+    Slot stages[kStages];
+    Slot next;             // Instruction executed but not yet issued
+    uint32_t nextPC;
+    bool hasNext;
+    bool issuing;          // next is waiting for the IF stage
+    uint32_t controlLeft;  // Control bubbles still to fetch
+    uint64_t clock;
+    uint64_t retired;
+    uint64_t stalls[static_cast<size_t>(StallCause::Count)];
+};
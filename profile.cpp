@@ -0,0 +1,108 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+#include <utility>
+
+namespace {
+
+uint64_t pairKey(uint32_t first, uint32_t second) { return (static_cast<uint64_t>(first) << 32) | second; }
+
+}  // namespace
+
+void Profiler::start(uint32_t textEnd, const std::unordered_map<std::string, uint32_t>& labels) {
+    counts.assign(textEnd > 0x0100 ? (textEnd - 0x0100) >> 2 : 0, 0);
+    outsideText = 0;
+
+    std::vector<std::pair<uint32_t, std::string>> sorted;
+    for (const auto& label : labels) sorted.emplace_back(label.second, label.first);
+    std::sort(sorted.begin(), sorted.end());
+    starts.assign(1, 0x0100);
+    functions.assign(1, "(unlabelled)");
+    for (const auto& label : sorted) {
+        if (label.first == starts.back() && starts.size() > 1) continue;  // Aliases keep the first name
+        starts.push_back(label.first);
+        functions.push_back(label.second);
+    }
+
+    paths.assign(1, Path{0, functionIndex(0x0100)});
+    pathCounts.assign(1, 0);
+    children.clear();
+    calls.clear();
+    stack.assign(1, 0);
+    overflow = 0;
+}
+
+uint32_t Profiler::functionIndex(uint32_t pc) const {
+    return static_cast<uint32_t>(std::upper_bound(starts.begin() + 1, starts.end(), pc) - starts.begin() - 1);
+}
+
+void Profiler::enter(uint32_t target) {
+    uint32_t caller = paths[stack.back()].function;
+    uint32_t callee = functionIndex(target);
+    calls[pairKey(caller, callee)]++;
+    if (stack.size() == kMaxDepth) {
+        overflow++;
+        return;
+    }
+    auto inserted = children.emplace(pairKey(stack.back(), callee), static_cast<uint32_t>(paths.size()));
+    if (inserted.second) {
+        paths.push_back(Path{stack.back(), callee});
+        pathCounts.push_back(0);
+    }
+    stack.push_back(inserted.first->second);
+}
+
+void Profiler::leave() {
+    if (overflow > 0) {
+        overflow--;
+    } else if (stack.size() > 1) {
+        stack.pop_back();
+    }
+}
+
+std::vector<HotSpot> Profiler::hotSpots(size_t limit) const {
+    std::vector<HotSpot> spots;
+    for (size_t index = 0; index < counts.size(); index++) {
+        if (counts[index] > 0) spots.push_back(HotSpot{static_cast<uint32_t>(0x0100 + index * 4), counts[index]});
+    }
+    limit = std::min(limit, spots.size());
+    std::partial_sort(spots.begin(), spots.begin() + limit, spots.end(), [](const HotSpot& a, const HotSpot& b) {
+        return a.count != b.count ? a.count > b.count : a.pc < b.pc;
+    });
+    spots.resize(limit);
+    return spots;
+}
+
+uint64_t Profiler::instructions() const { return std::accumulate(counts.begin(), counts.end(), outsideText); }
+
+const std::string& Profiler::functionAt(uint32_t pc, uint32_t& offset) const {
+    uint32_t function = functionIndex(pc);
+    offset = pc - starts[function];
+    return functions[function];
+}
+
+void Profiler::printCallGraph(std::ostream& out) const {
+    std::vector<std::pair<uint64_t, uint64_t>> edges(calls.begin(), calls.end());
+    std::sort(edges.begin(), edges.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    for (const auto& edge : edges) {
+        out << functions[edge.first >> 32] << " -> " << functions[edge.first & 0xFFFFFFFF] << ": " << edge.second
+            << " calls\n";
+    }
+}
+
+void Profiler::printFoldedStacks(std::ostream& out) const {
+    for (size_t path = 0; path < paths.size(); path++) {
+        if (pathCounts[path] == 0) continue;
+        std::vector<uint32_t> frames;
+        for (uint32_t node = static_cast<uint32_t>(path);; node = paths[node].parent) {
+            frames.push_back(paths[node].function);
+            if (node == 0) break;
+        }
+        for (size_t frame = frames.size(); frame-- > 0;) out << functions[frames[frame]] << (frame > 0 ? ";" : "");
+        out << " " << pathCounts[path] << "\n";
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "decode.h"
+
+// One executed address and how often it ran
+struct HotSpot {
+    uint32_t pc;
+    uint64_t count;
+};
+
+// Per-PC execution counts and call stacks of an interpreter run. Counts live in a flat array
+// indexed by (PC - 0x100) >> 2. Code is attributed to the label it follows; jal enters the
+// label of its target and jr $ra returns from it, so every call path gets its own count
+// for folded-stack (flamegraph) output.
+class Profiler {
+   public:
+    // Starts a run over the text words below textEnd, named by labels (label -> address of its
+    // first word)
+    void start(uint32_t textEnd, const std::unordered_map<std::string, uint32_t>& labels);
+
+    // Counts decoded, executed at pc, and follows the calls and returns it makes
+    void execute(const DecodedInstruction& decoded, uint32_t pc) {
+        uint32_t index = (pc - 0x0100) >> 2;
+        if (index < counts.size()) {
+            counts[index]++;
+        } else {
+            outsideText++;
+        }
+        pathCounts[stack.back()]++;
+        if (decoded.op == Op::Jal) {
+            enter(decoded.imm);
+        } else if (decoded.op == Op::Jr) {
+            leave();
+        }
+    }
+
+    // The limit most executed addresses, most executed first
+    std::vector<HotSpot> hotSpots(size_t limit) const;
+
+    uint64_t instructions() const;
+    uint64_t instructionsOutsideText() const { return outsideText; }
+
+    // Label whose code holds pc and the offset of pc from its start
+    const std::string& functionAt(uint32_t pc, uint32_t& offset) const;
+
+    // Prints "caller -> callee: calls" for every call edge, most frequent first
+    void printCallGraph(std::ostream& out) const;
+
+    // Prints one "outer;...;inner count" line per call path that executed instructions
+    void printFoldedStacks(std::ostream& out) const;
+
+   private:
+    // Node of the call path tree: a function called from the path of its parent
+    struct Path {
+        uint32_t parent;
+        uint32_t function;  // Index into functions
+    };
+
+    static constexpr size_t kMaxDepth = 256;  // Deeper calls are counted in their caller's path
+
+    uint32_t functionIndex(uint32_t pc) const;
+    void enter(uint32_t target);
+    void leave();
+
+    std::vector<uint64_t> counts;             // Per text word
+    uint64_t outsideText;                     // Instructions fetched from outside the text words
+    std::vector<uint32_t> starts;             // Start address of each function, ascending
+    std::vector<std::string> functions;       // Their labels; functions[0] is code before any label
+    std::vector<Path> paths;                  // paths[0] is the entry path
+    std::vector<uint64_t> pathCounts;         // Instructions executed in each path
+    std::unordered_map<uint64_t, uint32_t> children;  // (parent path, function) -> path
+    std::unordered_map<uint64_t, uint64_t> calls;     // (caller, callee) function indices -> calls
+    std::vector<uint32_t> stack;              // Current call path, innermost last
+    uint32_t overflow;                        // Calls beyond kMaxDepth not yet returned from
+};
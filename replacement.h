@@ -0,0 +1,323 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Replacement policies for SetAssociativeCache. Every policy keeps its state in flat per-set
+// arrays and provides:
+//   Policy(sets, ways)
+//   void hit(set, way)
+//   uint32_t miss(set, tag, freeWay, setTags)  way to replace with tag; freeWay is an empty
+//                                              way or -1 when the set is full
+//   void fill(set, way)                        the way chosen by miss now holds the new line
+
+// Tag of an empty line. Real tags drop at least the two offset bits, so never match it.
+constexpr uint32_t kInvalidTag = UINT32_MAX;
+
+// Recency order of the ways of every set as access stamps from a shared counter. Hits are
+// O(1); finding the oldest way scans the set. When the counter wraps, every set is
+// renumbered 1 .. ways in its current order.
+class RecencyOrder {
+   public:
+    RecencyOrder(uint32_t sets, uint32_t ways) : ways(ways), clock(0), stamps(static_cast<size_t>(sets) * ways) {}
+
+    // Makes way the most recently used of its set
+    void touch(uint32_t set, uint32_t way) {
+        if (++clock == 0) renumber();
+        stamps[set * ways + way] = clock;
+    }
+
+    // way was used less recently than other
+    bool older(uint32_t set, uint32_t way, uint32_t other) const {
+        return stamps[set * ways + way] < stamps[set * ways + other];
+    }
+
+    // Least recently used way of set
+    uint32_t oldest(uint32_t set) const {
+        const uint32_t* setStamps = &stamps[set * ways];
+        return static_cast<uint32_t>(std::min_element(setStamps, setStamps + ways) - setStamps);
+    }
+
+   private:
+    void renumber() {
+        std::vector<uint32_t> byAge(ways);
+        for (size_t first = 0; first < stamps.size(); first += ways) {
+            for (uint32_t way = 0; way < ways; way++) byAge[way] = way;
+            std::sort(byAge.begin(), byAge.end(), [&](uint32_t a, uint32_t b) { return stamps[first + a] < stamps[first + b]; });
+            for (uint32_t age = 0; age < ways; age++) stamps[first + byAge[age]] = age + 1;
+        }
+        clock = ways + 1;
+    }
+
+    uint32_t ways;
+    uint32_t clock;
+    std::vector<uint32_t> stamps;
+};
+
+class LruPolicy {
+   public:
+    LruPolicy(uint32_t sets, uint32_t ways) : order(sets, ways) {}
+
+    void hit(uint32_t set, uint32_t way) { order.touch(set, way); }
+
+    uint32_t miss(uint32_t set, uint32_t, int freeWay, const uint32_t*) const {
+        return freeWay >= 0 ? static_cast<uint32_t>(freeWay) : order.oldest(set);
+    }
+
+    void fill(uint32_t set, uint32_t way) { order.touch(set, way); }
+
+   private:
+    RecencyOrder order;
+};
+
+// Fewest accesses since the fill; the least recently used line among equals
+class LfuPolicy {
+   public:
+    LfuPolicy(uint32_t sets, uint32_t ways) : ways(ways), counts(static_cast<size_t>(sets) * ways), order(sets, ways) {}
+
+    void hit(uint32_t set, uint32_t way) {
+        counts[set * ways + way]++;
+        order.touch(set, way);
+    }
+
+    uint32_t miss(uint32_t set, uint32_t, int freeWay, const uint32_t*) const {
+        return freeWay >= 0 ? static_cast<uint32_t>(freeWay) : leastFrequent(set);
+    }
+
+    void fill(uint32_t set, uint32_t way) {
+        counts[set * ways + way] = 1;
+        order.touch(set, way);
+    }
+
+   private:
+    uint32_t leastFrequent(uint32_t set) const {
+        const uint32_t* setCounts = &counts[set * ways];
+        uint32_t chosen = 0;
+        for (uint32_t way = 1; way < ways; way++) {
+            if (setCounts[way] < setCounts[chosen] ||
+                (setCounts[way] == setCounts[chosen] && order.older(set, way, chosen))) {
+                chosen = way;
+            }
+        }
+        return chosen;
+    }
+
+    uint32_t ways;
+    std::vector<uint32_t> counts;
+    RecencyOrder order;
+};
+
+// Second chance: the hand skips and clears referenced lines
+class ClockPolicy {
+   public:
+    ClockPolicy(uint32_t sets, uint32_t ways)
+        : ways(ways), referenced(static_cast<size_t>(sets) * ways), hands(sets) {}
+
+    void hit(uint32_t set, uint32_t way) { referenced[set * ways + way] = 1; }
+
+    uint32_t miss(uint32_t set, uint32_t, int freeWay, const uint32_t*) {
+        if (freeWay >= 0) return static_cast<uint32_t>(freeWay);
+        uint8_t* setReferenced = &referenced[set * ways];
+        uint32_t& hand = hands[set];
+        while (setReferenced[hand]) {
+            setReferenced[hand] = 0;
+            hand = hand + 1 < ways ? hand + 1 : 0;
+        }
+        uint32_t way = hand;
+        hand = hand + 1 < ways ? hand + 1 : 0;
+        return way;
+    }
+
+    void fill(uint32_t set, uint32_t way) { referenced[set * ways + way] = 1; }
+
+   private:
+    uint32_t ways;
+    std::vector<uint8_t> referenced;
+    std::vector<uint32_t> hands;
+};
+
+// Uniformly random victim from a fixed-seed xorshift generator, so runs are repeatable
+class RandomPolicy {
+   public:
+    RandomPolicy(uint32_t, uint32_t ways) : ways(ways), state(0x9E3779B9u) {}
+
+    void hit(uint32_t, uint32_t) {}
+
+    uint32_t miss(uint32_t, uint32_t, int freeWay, const uint32_t*) {
+        if (freeWay >= 0) return static_cast<uint32_t>(freeWay);
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % ways;
+    }
+
+    void fill(uint32_t, uint32_t) {}
+
+   private:
+    uint32_t ways;
+    uint32_t state;
+};
+
+// Tree pseudo-LRU over a power-of-two number of ways. Each set has ways - 1 bits forming a
+// binary tree stored heap-style from node 1; a bit of 0 sends the victim search left.
+class TreePlruPolicy {
+   public:
+    TreePlruPolicy(uint32_t sets, uint32_t ways)
+        : ways(ways), wordsPerSet((ways + 63) / 64), bits(static_cast<size_t>(sets) * wordsPerSet) {}
+
+    void hit(uint32_t set, uint32_t way) { touch(set, way); }
+
+    uint32_t miss(uint32_t set, uint32_t, int freeWay, const uint32_t*) const {
+        if (freeWay >= 0) return static_cast<uint32_t>(freeWay);
+        uint32_t node = 1;
+        while (node < ways) node = 2 * node + bit(set, node);
+        return node - ways;
+    }
+
+    void fill(uint32_t set, uint32_t way) { touch(set, way); }
+
+   private:
+    bool bit(uint32_t set, uint32_t node) const { return (bits[set * wordsPerSet + node / 64] >> (node % 64)) & 1; }
+
+    // Points every node on the path to way away from it
+    void touch(uint32_t set, uint32_t way) {
+        for (uint32_t node = way + ways; node > 1; node /= 2) {
+            uint64_t& word = bits[set * wordsPerSet + (node / 2) / 64];
+            uint64_t mask = uint64_t(1) << ((node / 2) % 64);
+            if (node % 2 == 0) {
+                word |= mask;  // Came from the left child: send the search right
+            } else {
+                word &= ~mask;
+            }
+        }
+    }
+
+    uint32_t ways;
+    uint32_t wordsPerSet;
+    std::vector<uint64_t> bits;
+};
+
+// Adaptive replacement (Megiddo and Modha) within each set. Resident lines are in T1 (seen
+// once) or T2 (seen again); ghost lists B1 and B2 remember the tags recently evicted from
+// each. A miss on a ghost tag moves the per-set target size of T1 towards the list that
+// would have kept it.
+class ArcPolicy {
+   public:
+    ArcPolicy(uint32_t sets, uint32_t ways)
+        : ways(ways),
+          inT2(static_cast<size_t>(sets) * ways),
+          order(sets, ways),
+          ghostTags(static_cast<size_t>(sets) * ways, kInvalidTag),
+          ghostInB2(static_cast<size_t>(sets) * ways),
+          ghostOrder(sets, ways),
+          targets(sets),
+          fillsT2(false) {}
+
+    void hit(uint32_t set, uint32_t way) {
+        inT2[set * ways + way] = 1;
+        order.touch(set, way);
+    }
+
+    uint32_t miss(uint32_t set, uint32_t tag, int freeWay, const uint32_t* setTags) {
+        uint32_t t1 = 0, t2 = 0;
+        for (uint32_t way = 0; way < ways; way++) {
+            if (setTags[way] == kInvalidTag) continue;
+            (inT2[set * ways + way] ? t2 : t1)++;
+        }
+        uint32_t b1 = ghostCount(set, false), b2 = ghostCount(set, true);
+        uint32_t& target = targets[set];
+
+        int ghost = findGhost(set, tag);
+        bool inB1 = ghost >= 0 && !ghostInB2[set * ways + ghost];
+        bool inB2 = ghost >= 0 && ghostInB2[set * ways + ghost];
+        bool keepGhost = true;
+        if (inB1) {
+            target = std::min(ways, target + std::max(1u, b2 / b1));
+            ghostTags[set * ways + ghost] = kInvalidTag;
+        } else if (inB2) {
+            uint32_t step = std::max(1u, b1 / b2);
+            target = target > step ? target - step : 0;
+            ghostTags[set * ways + ghost] = kInvalidTag;
+        } else if (t1 + b1 == ways) {
+            if (b1 > 0) {
+                dropOldestGhost(set, false);
+            } else {
+                keepGhost = false;  // T1 fills the set: its oldest line leaves without a ghost
+            }
+        } else if (t1 + t2 + b1 + b2 >= 2 * ways && b2 > 0) {
+            dropOldestGhost(set, true);
+        }
+
+        fillsT2 = inB1 || inB2;
+        if (freeWay >= 0) return static_cast<uint32_t>(freeWay);
+        bool fromT2 = t1 == 0 || (t2 > 0 && keepGhost && t1 < target + (inB2 ? 0 : 1));
+        uint32_t way = oldest(set, fromT2, setTags);
+        if (keepGhost) addGhost(set, setTags[way], fromT2);
+        return way;
+    }
+
+    void fill(uint32_t set, uint32_t way) {
+        inT2[set * ways + way] = fillsT2;
+        order.touch(set, way);
+    }
+
+   private:
+    // Least recently used resident line of T1 or T2
+    uint32_t oldest(uint32_t set, bool t2, const uint32_t* setTags) const {
+        int chosen = -1;
+        for (uint32_t way = 0; way < ways; way++) {
+            if (setTags[way] == kInvalidTag || bool(inT2[set * ways + way]) != t2) continue;
+            if (chosen < 0 || order.older(set, way, static_cast<uint32_t>(chosen))) chosen = static_cast<int>(way);
+        }
+        return static_cast<uint32_t>(chosen);
+    }
+
+    int findGhost(uint32_t set, uint32_t tag) const {
+        const uint32_t* tags = &ghostTags[set * ways];
+        for (uint32_t slot = 0; slot < ways; slot++) {
+            if (tags[slot] == tag) return static_cast<int>(slot);
+        }
+        return -1;
+    }
+
+    uint32_t ghostCount(uint32_t set, bool b2) const {
+        uint32_t count = 0;
+        for (uint32_t slot = 0; slot < ways; slot++) {
+            if (ghostTags[set * ways + slot] != kInvalidTag && bool(ghostInB2[set * ways + slot]) == b2) count++;
+        }
+        return count;
+    }
+
+    // Forgets the least recently evicted tag of B1 or B2; false if that list is empty
+    bool dropOldestGhost(uint32_t set, bool b2) {
+        int chosen = -1;
+        for (uint32_t slot = 0; slot < ways; slot++) {
+            if (ghostTags[set * ways + slot] == kInvalidTag || bool(ghostInB2[set * ways + slot]) != b2) continue;
+            if (chosen < 0 || ghostOrder.older(set, slot, static_cast<uint32_t>(chosen))) chosen = static_cast<int>(slot);
+        }
+        if (chosen < 0) return false;
+        ghostTags[set * ways + chosen] = kInvalidTag;
+        return true;
+    }
+
+    void addGhost(uint32_t set, uint32_t tag, bool b2) {
+        int slot = findGhost(set, kInvalidTag);
+        if (slot < 0) {
+            // The list bounds keep a slot free; make room anyway if they were bypassed
+            if (!dropOldestGhost(set, true)) dropOldestGhost(set, false);
+            slot = findGhost(set, kInvalidTag);
+        }
+        ghostTags[set * ways + slot] = tag;
+        ghostInB2[set * ways + slot] = b2;
+        ghostOrder.touch(set, static_cast<uint32_t>(slot));
+    }
+
+    uint32_t ways;
+    std::vector<uint8_t> inT2;        // Per line: 1 for T2, 0 for T1
+    RecencyOrder order;               // Recency of the resident lines
+    std::vector<uint32_t> ghostTags;  // ways ghost slots per set, kInvalidTag when free
+    std::vector<uint8_t> ghostInB2;   // Per ghost slot: 1 for B2, 0 for B1
+    RecencyOrder ghostOrder;          // Recency of the ghost slots
+    std::vector<uint32_t> targets;    // Target size of T1 per set
+    bool fillsT2;                     // The last miss was a ghost hit, so its line enters T2
+};
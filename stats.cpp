@@ -0,0 +1,199 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <ostream>
+
+namespace {
+
+// Spreads the bits of value over the whole word (splitmix64 finalizer)
+uint64_t hashOf(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+// Bucket of a histogram whose bucket 0 is 0 and bucket b holds [2^(b-1), 2^b)
+size_t powerOfTwoBucket(double value, size_t buckets) {
+    size_t bucket = 0;
+    while (bucket + 1 < buckets && value >= static_cast<double>(uint64_t(1) << bucket)) bucket++;
+    return bucket;
+}
+
+// Writes a power-of-two histogram as [{"min": low, "max": high, "count": n}, ...], skipping
+// empty buckets; the last bucket has no max
+template <typename Count>
+void writeHistogram(std::ostream& out, const Count* counts, size_t buckets) {
+    out << "[";
+    bool first = true;
+    for (size_t bucket = 0; bucket < buckets; bucket++) {
+        if (counts[bucket] == 0) continue;
+        uint64_t low = bucket == 0 ? 0 : uint64_t(1) << (bucket - 1);
+        out << (first ? "" : ", ") << "{\"min\": " << low;
+        if (bucket + 1 < buckets) out << ", \"max\": " << (bucket == 0 ? 0 : (uint64_t(1) << bucket) - 1);
+        out << ", \"count\": " << counts[bucket] << "}";
+        first = false;
+    }
+    out << "]";
+}
+
+}  // namespace
+
+const char* instructionClassName(InstructionClass kind) {
+    switch (kind) {
+        case InstructionClass::Alu:
+            return "alu";
+        case InstructionClass::MultiplyDivide:
+            return "multiply_divide";
+        case InstructionClass::Load:
+            return "load";
+        case InstructionClass::Store:
+            return "store";
+        case InstructionClass::BranchTaken:
+            return "branch_taken";
+        case InstructionClass::BranchNotTaken:
+            return "branch_not_taken";
+        case InstructionClass::Jump:
+            return "jump";
+        case InstructionClass::Syscall:
+            return "syscall";
+        case InstructionClass::Nop:
+            return "nop";
+        case InstructionClass::Count:
+            break;
+    }
+    return "unknown";
+}
+
+void DistinctCounter::add(uint64_t value) {
+    uint64_t hash = hashOf(value);
+    size_t index = hash >> (64 - kBits);
+    uint64_t rest = (hash << kBits) | (uint64_t(1) << (kBits - 1));  // The sentinel bounds the rank
+    uint8_t rank = 1;
+    while ((rest >> 63) == 0) {
+        rank++;
+        rest <<= 1;
+    }
+    registers[index] = std::max(registers[index], rank);
+}
+
+double DistinctCounter::estimate() const {
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t rank : registers) {
+        sum += std::ldexp(1.0, -rank);
+        if (rank == 0) zeros++;
+    }
+    double buckets = static_cast<double>(kRegisters);
+    double estimate = 0.7213 / (1 + 1.079 / buckets) * buckets * buckets / sum;
+    if (estimate <= 2.5 * buckets && zeros > 0) estimate = buckets * std::log(buckets / zeros);  // Linear counting
+    return estimate;
+}
+
+void ReuseSampler::access(uint64_t line) {
+    uint32_t hash = static_cast<uint32_t>(hashOf(line) >> 32);
+    if (hash >= threshold) return;
+    double weight = static_cast<double>(kFullRate) / threshold;
+
+    auto found = std::find_if(stack.begin(), stack.end(), [line](const Entry& entry) { return entry.line == line; });
+    if (found != stack.end()) {
+        // Tracked lines touched since the last access to this one, scaled to all lines
+        double distance = static_cast<double>(found - stack.begin()) * weight;
+        histogram[powerOfTwoBucket(distance, kBuckets)] += weight;
+        std::rotate(stack.begin(), found, found + 1);
+        return;
+    }
+
+    cold += weight;
+    if (stack.size() == kCapacity) {
+        auto largest = std::max_element(stack.begin(), stack.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+        if (largest->hash < hash) {
+            threshold = hash;  // The new line is the one to drop
+            return;
+        }
+        threshold = largest->hash;
+        stack.erase(largest);
+    }
+    stack.insert(stack.begin(), Entry{line, hash});
+}
+
+void WorkloadStats::reset() {
+    instructions = 0;
+    std::fill(std::begin(mix), std::end(mix), 0);
+    currentPC = 0;
+    loads = 0;
+    stores = 0;
+    words = DistinctCounter();
+    lines = DistinctCounter();
+    pages = DistinctCounter();
+    lastAccess.assign(kStrideEntries, StrideEntry{UINT32_MAX, 0});  // No PC is odd
+    std::fill(std::begin(strides), std::end(strides), 0);
+    backwardStrides = 0;
+    reuse = ReuseSampler();
+}
+
+InstructionClass WorkloadStats::classOf(Op op) {
+    switch (op) {
+        case Op::Mult:
+        case Op::Div:
+        case Op::Mfhi:
+        case Op::Mflo:
+            return InstructionClass::MultiplyDivide;
+        case Op::Lw:
+            return InstructionClass::Load;
+        case Op::Sw:
+            return InstructionClass::Store;
+        case Op::J:
+        case Op::Jal:
+        case Op::Jr:
+            return InstructionClass::Jump;
+        case Op::Syscall:
+            return InstructionClass::Syscall;
+        case Op::Nop:
+            return InstructionClass::Nop;
+        default:
+            return InstructionClass::Alu;
+    }
+}
+
+void WorkloadStats::access(uint32_t address, bool write) {
+    (write ? stores : loads)++;
+    words.add(address / 4);
+    lines.add(address / kLineBytes);
+    pages.add(address / kPageBytes);
+
+    StrideEntry& entry = lastAccess[(currentPC >> 2) & (kStrideEntries - 1)];
+    if (entry.pc == currentPC) {
+        int64_t stride = static_cast<int64_t>(address) - entry.address;
+        if (stride < 0) backwardStrides++;
+        strides[powerOfTwoBucket(static_cast<double>(stride < 0 ? -stride : stride), kStrideBuckets)]++;
+    }
+    entry = StrideEntry{currentPC, address};
+
+    reuse.access(address / kLineBytes);
+}
+
+void WorkloadStats::writeJson(std::ostream& out) const {
+    out << "{\n  \"instructions\": " << instructions << ",\n  \"mix\": {";
+    for (size_t kind = 0; kind < static_cast<size_t>(InstructionClass::Count); kind++) {
+        out << (kind > 0 ? ", " : "") << "\"" << instructionClassName(static_cast<InstructionClass>(kind)) << "\": " << mix[kind];
+    }
+    out << "},\n  \"memory\": {\n    \"loads\": " << loads << ",\n    \"stores\": " << stores << ",\n";
+    out << "    \"line_bytes\": " << kLineBytes << ",\n    \"page_bytes\": " << kPageBytes << ",\n";
+    out << "    \"working_set\": {\"words\": " << std::llround(words.estimate()) << ", \"lines\": " << std::llround(lines.estimate())
+        << ", \"pages\": " << std::llround(pages.estimate()) << "},\n";
+    out << "    \"strides\": {\"backward\": " << backwardStrides << ", \"bytes\": ";
+    writeHistogram(out, strides, kStrideBuckets);
+    out << "},\n";
+
+    // Reuse counts are estimates; round them like the working sets
+    std::vector<uint64_t> distances;
+    for (double count : reuse.distances()) distances.push_back(static_cast<uint64_t>(std::llround(count)));
+    out << "    \"reuse_distance\": {\"sample_rate\": " << reuse.sampleRate() << ", \"cold\": " << std::llround(reuse.coldAccesses())
+        << ", \"lines\": ";
+    writeHistogram(out, distances.data(), distances.size());
+    out << "}\n  }\n}\n";
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "decode.h"
+
+// Dynamic instruction classes of the mix
+enum class InstructionClass : uint8_t {
+    Alu,             // add, sub, and, or, slt, addi and unknown R-type operations
+    MultiplyDivide,  // mult, div, mfhi, mflo
+    Load,
+    Store,
+    BranchTaken,
+    BranchNotTaken,
+    Jump,            // j, jal and jr
+    Syscall,
+    Nop,
+    Count,
+};
+
+const char* instructionClassName(InstructionClass kind);
+
+// Distinct-value estimate in constant space (HyperLogLog with 2^kBits one-byte registers,
+// about 3% standard error, exact-ish linear counting for small sets)
+class DistinctCounter {
+   public:
+    DistinctCounter() : registers(kRegisters, 0) {}
+
+    void add(uint64_t value);
+    double estimate() const;
+
+   private:
+    static constexpr uint32_t kBits = 10;
+    static constexpr size_t kRegisters = size_t(1) << kBits;
+
+    std::vector<uint8_t> registers;  // Per bucket: the longest run of leading zeros seen, plus one
+};
+
+// Reuse distances of a fixed-size spatial sample of lines (SHARDS). A line is tracked when
+// its hash falls below a threshold; once kCapacity lines are tracked the threshold drops to
+// evict the largest hash, so the sample rate adapts to the footprint. Distances and counts are
+// scaled by the inverse of the rate at the time of the access.
+class ReuseSampler {
+   public:
+    static constexpr size_t kBuckets = 24;  // Bucket 0 is distance 0, bucket b is [2^(b-1), 2^b)
+
+    ReuseSampler() : threshold(kFullRate), cold(0), histogram(kBuckets, 0) {}
+
+    void access(uint64_t line);
+
+    double sampleRate() const { return static_cast<double>(threshold) / kFullRate; }
+    double coldAccesses() const { return cold; }
+    const std::vector<double>& distances() const { return histogram; }
+
+   private:
+    static constexpr size_t kCapacity = 4096;
+    static constexpr uint64_t kFullRate = uint64_t(1) << 32;
+
+    struct Entry {
+        uint64_t line;
+        uint32_t hash;
+    };
+
+    std::vector<Entry> stack;  // Tracked lines, most recently used first
+    uint64_t threshold;        // Lines whose 32-bit hash is below it are tracked
+    double cold;               // Estimated first accesses
+    std::vector<double> histogram;  // Estimated accesses per distance bucket, in distinct lines
+};
+
+// Instruction mix and data access pattern of an interpreter run, in bounded memory: working
+// sets are estimated, strides are taken per load/store PC from a small direct-mapped table and
+// reuse distances from a sample of lines.
+class WorkloadStats {
+   public:
+    static constexpr uint32_t kLineBytes = 64;
+    static constexpr uint32_t kPageBytes = 4096;
+    static constexpr size_t kStrideBuckets = 18;  // 0, then |stride| in [2^(b-1), 2^b), the last open-ended
+
+    WorkloadStats() { reset(); }
+
+    void reset();
+
+    // Counts decoded, executed at pc; beq is counted by countBranch once its outcome is known
+    void countInstruction(const DecodedInstruction& decoded, uint32_t pc) {
+        currentPC = pc;
+        instructions++;
+        if (decoded.op != Op::Beq) mix[static_cast<size_t>(classOf(decoded.op))]++;
+    }
+
+    void countBranch(bool taken) {
+        mix[static_cast<size_t>(taken ? InstructionClass::BranchTaken : InstructionClass::BranchNotTaken)]++;
+    }
+
+    // Records a data access by the instruction last counted
+    void access(uint32_t address, bool write);
+
+    // Writes every statistic as one JSON object
+    void writeJson(std::ostream& out) const;
+
+   private:
+    static constexpr size_t kStrideEntries = 256;
+
+    // Last address accessed by a load or store PC
+    struct StrideEntry {
+        uint32_t pc;
+        uint32_t address;
+    };
+
+    static InstructionClass classOf(Op op);
+
+    uint64_t instructions;
+    uint64_t mix[static_cast<size_t>(InstructionClass::Count)];
+    uint32_t currentPC;
+    uint64_t loads, stores;
+    DistinctCounter words, lines, pages;
+    std::vector<StrideEntry> lastAccess;  // Direct-mapped by PC
+    uint64_t strides[kStrideBuckets];
+    uint64_t backwardStrides;
+    ReuseSampler reuse;
+};
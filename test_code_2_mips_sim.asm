@@ -0,0 +1,37 @@
+.data
+limit: .word 20
+sum: .word 0
+
+.text
+start:
+    addi $t7, $zero, 0        # Loop counter i = 0
+    lw $t8, limit             # Loop limit 20
+    addi $t0, $zero, 0        # Fibonacci pair (a, b) = (0, 1)
+    addi $t1, $zero, 1
+
+loop:
+    lw $t3, sum               # Load previous sum
+    addi $t7, $t7, 1          # i++
+    add $t3, $t3, $t7         # sum += i
+    sw $t3, sum               # Store accumulated sum
+
+    add $t2, $t0, $t1         # a + b
+    add $t0, $zero, $t1       # a = b
+    add $t1, $zero, $t2       # b = a + b
+
+    slt $t4, $t7, $t8         # i < limit?
+    beq $t4, $zero, print     # If not, jump to print
+
+    j loop                    # Else continue loop
+
+print:
+    lw $a0, sum               # Load accumulated sum (210) to $a0
+    addi $v0, $zero, 1        # Syscall code for print integer
+    syscall                   # Print the sum
+
+    add $a0, $zero, $t0       # Fibonacci number 20 (6765)
+    syscall                   # Print it
+
+exit:
+    addi $v0, $zero, 10       # Syscall code for exit
+    syscall                   # Exit program
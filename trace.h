@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Trace verbosity, ordered from quietest to noisiest
+enum class TraceLevel : uint8_t {
+    Off = 0,          // No trace output
+    Summary = 1,      // End of run messages, final memory and register dumps
+    Instruction = 2,  // Per-instruction PC, operands, memory and register updates
+    Signal = 3,       // Control signals and ALU results
+};
+
+// Highest trace level compiled into the simulator.
+// Build with -DMIPS_TRACE_MAX_LEVEL=0 for a silent interpreter loop.
+#ifndef MIPS_TRACE_MAX_LEVEL
+#define MIPS_TRACE_MAX_LEVEL 3
+#endif
+
+constexpr TraceLevel kMaxTraceLevel = static_cast<TraceLevel>(MIPS_TRACE_MAX_LEVEL);
+
+// Runtime trace filter capped at compile time by MaxLevel.
+// Checks for levels above MaxLevel fold to false, so their output code is removed.
+template <TraceLevel MaxLevel>
+class Tracer {
+   public:
+    explicit Tracer(TraceLevel level) : level(level) {}
+
+    constexpr bool enabled(TraceLevel check) const { return check <= MaxLevel && check <= level; }
+
+   private:
+    TraceLevel level;
+};
+
+// Parses "off", "summary", "instruction" or "signal"; returns false for anything else
+inline bool parseTraceLevel(const std::string& name, TraceLevel& level) {
+    if (name == "off") {
+        level = TraceLevel::Off;
+    } else if (name == "summary") {
+        level = TraceLevel::Summary;
+    } else if (name == "instruction") {
+        level = TraceLevel::Instruction;
+    } else if (name == "signal") {
+        level = TraceLevel::Signal;
+    } else {
+        return false;
+    }
+    return true;
+}